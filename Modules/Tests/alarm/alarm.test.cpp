@@ -29,6 +29,18 @@ static const TM s_alarm_datetime = {
    0 // ignored by util_time
 };
 
+static UNIX_TIMESTAMP unix_time(int year, int mon, int mday, int hour, int min)
+{
+   TM tm = s_alarm_datetime;
+   tm.tm_year = year;
+   tm.tm_mon = mon;
+   tm.tm_mday = mday;
+   tm.tm_hour = hour;
+   tm.tm_min = min;
+   tm.tm_sec = 0;
+   return time_to_unix_seconds(&tm);
+}
+
 class AlarmTest : public CppUnit::TestFixture  {
 
    CPPUNIT_TEST_SUITE(AlarmTest);
@@ -71,6 +83,25 @@ class AlarmTest : public CppUnit::TestFixture  {
    CPPUNIT_TEST(HourlyAlarmTestExpiresAfterCorrectDuration);
    CPPUNIT_TEST(HourlyAlarmTestExpiresWhenCancelledEarlyAndIsNotRetriggered);
 
+   CPPUNIT_TEST(NextTriggerTimeTestHourly);
+   CPPUNIT_TEST(NextTriggerTimeTestDailyWithRepeat);
+   CPPUNIT_TEST(NextTriggerTimeTestWeekly);
+   CPPUNIT_TEST(NextTriggerTimeTestMonthlySkipsShortMonths);
+   CPPUNIT_TEST(NextTriggerTimeTestYearlyOnLeapDay);
+   CPPUNIT_TEST(NextTriggerTimeTestWaitsForDurationToExpire);
+   CPPUNIT_TEST(NextTriggerTimeTestWithAddedMatches);
+
+   CPPUNIT_TEST(AddedMatchTestQuarterHourlyAlarm);
+   CPPUNIT_TEST(AddedMatchTestMatchesFieldsIndependently);
+
+   CPPUNIT_TEST(AdvanceToTestCountsSkippedMatches);
+   CPPUNIT_TEST(AdvanceToTestTriggersAndExpiresInSkippedSpan);
+   CPPUNIT_TEST(AdvanceToTestSkipsWholeCycles);
+   CPPUNIT_TEST(AdvanceToTestBackwardsJumpIsSingleUpdate);
+
+   CPPUNIT_TEST(UnixTimeTestWeeklyAlarmTriggersAndExpires);
+   CPPUNIT_TEST(UnixTimeTestCachedMinuteMatchesConversion);
+
    CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -612,6 +643,192 @@ protected:
       CPPUNIT_ASSERT(!alarm.set_current_time(&datetime));
       CPPUNIT_ASSERT(!alarm.is_triggered());
    }
+
+   void NextTriggerTimeTestHourly()
+   {
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 60);
+
+      // The current minute counts, the next minute waits for the next hour
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 4, 20, 05), alarm.next_trigger_time(unix_time(96, JUL, 4, 20, 05)));
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 4, 21, 05), alarm.next_trigger_time(unix_time(96, JUL, 4, 20, 06)));
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 5, 00, 05), alarm.next_trigger_time(unix_time(96, JUL, 4, 23, 59)));
+   }
+
+   void NextTriggerTimeTestDailyWithRepeat()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 3, 60);
+
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 6, 20, 05), alarm.next_trigger_time(unix_time(96, JUL, 4, 20, 05)));
+
+      // One match already counted leaves two to go
+      TM datetime = s_alarm_datetime;
+      CPPUNIT_ASSERT(!alarm.set_current_time(&datetime));
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 6, 20, 05), alarm.next_trigger_time(unix_time(96, JUL, 4, 20, 06)));
+   }
+
+   void NextTriggerTimeTestWeekly()
+   {
+      Alarm alarm = Alarm(INTERVAL_WEEK, &s_alarm_datetime, 2, 60);
+
+      // 4th July 1996 was a Thursday, so the first Sunday is the 7th
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 14, 20, 05), alarm.next_trigger_time(unix_time(96, JUL, 4, 12, 00)));
+   }
+
+   void NextTriggerTimeTestMonthlySkipsShortMonths()
+   {
+      TM alarm_time = s_alarm_datetime;
+      alarm_time.tm_mday = 31;
+      Alarm alarm = Alarm(INTERVAL_MONTH, &alarm_time, 2, 60);
+
+      // April and June have 30 days
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 31, 20, 05), alarm.next_trigger_time(unix_time(96, APR, 1, 00, 00)));
+   }
+
+   void NextTriggerTimeTestYearlyOnLeapDay()
+   {
+      TM alarm_time = s_alarm_datetime;
+      alarm_time.tm_mon = FEB;
+      alarm_time.tm_mday = 29;
+      Alarm alarm = Alarm(INTERVAL_YEAR, &alarm_time, 1, 60);
+
+      CPPUNIT_ASSERT_EQUAL(unix_time(100, FEB, 29, 20, 05), alarm.next_trigger_time(unix_time(96, MAR, 1, 00, 00)));
+   }
+
+   void NextTriggerTimeTestWaitsForDurationToExpire()
+   {
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 60);
+      CPPUNIT_ASSERT(alarm.set_current_time(&s_alarm_datetime));
+
+      // Triggered until 21:05, which is the first time the alarm would match again
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 4, 22, 05), alarm.next_trigger_time(unix_time(96, JUL, 4, 20, 06)));
+   }
+
+   void NextTriggerTimeTestWithAddedMatches()
+   {
+      Alarm alarm = Alarm(INTERVAL_WEEK, &s_alarm_datetime, 2, 60);
+      TM extra = s_alarm_datetime;
+      extra.tm_wday = WED;
+      CPPUNIT_ASSERT(alarm.add_match(&extra));
+
+      // Sunday 7th and Wednesday 10th July 1996 at 20:05
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 10, 20, 05), alarm.next_trigger_time(unix_time(96, JUL, 4, 12, 00)));
+   }
+
+   void AddedMatchTestQuarterHourlyAlarm()
+   {
+      TM alarm_time = s_alarm_datetime;
+      alarm_time.tm_min = 0;
+      Alarm alarm = Alarm(INTERVAL_HOUR, &alarm_time, 1, 1);
+
+      TM extra = alarm_time;
+      for (extra.tm_min = 15; extra.tm_min < 60; extra.tm_min += 15)
+      {
+         CPPUNIT_ASSERT(alarm.add_match(&extra));
+      }
+
+      TM datetime = alarm_time;
+      for (datetime.tm_min = 0; datetime.tm_min < 60; datetime.tm_min++)
+      {
+         bool expected = (datetime.tm_min % 15) == 0;
+         CPPUNIT_ASSERT_EQUAL(expected, alarm.set_current_time(&datetime));
+         alarm.deactivate();
+      }
+   }
+
+   void AddedMatchTestMatchesFieldsIndependently()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 60);
+      TM extra = s_alarm_datetime;
+      extra.tm_hour = 10;
+      extra.tm_min = 30;
+      alarm.add_match(&extra);
+
+      // 10:05 and 20:30 match as well as 10:30 and 20:05
+      TM datetime = s_alarm_datetime;
+      datetime.tm_hour = 10;
+      CPPUNIT_ASSERT(alarm.set_current_time(&datetime));
+      alarm.deactivate();
+
+      datetime.tm_hour = 20;
+      datetime.tm_min = 30;
+      CPPUNIT_ASSERT(alarm.set_current_time(&datetime));
+      alarm.deactivate();
+
+      datetime.tm_min = 31;
+      CPPUNIT_ASSERT(!alarm.set_current_time(&datetime));
+   }
+
+   void AdvanceToTestCountsSkippedMatches()
+   {
+      // Every third day at 20:05: two matches skipped, the third triggers
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 3, 60);
+      CPPUNIT_ASSERT(!alarm.advance_to(unix_time(96, JUL, 4, 12, 00)));
+      CPPUNIT_ASSERT(!alarm.advance_to(unix_time(96, JUL, 5, 21, 00)));
+      CPPUNIT_ASSERT(alarm.advance_to(unix_time(96, JUL, 6, 20, 05)));
+   }
+
+   void AdvanceToTestTriggersAndExpiresInSkippedSpan()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 60);
+      CPPUNIT_ASSERT(!alarm.advance_to(unix_time(96, JUL, 4, 12, 00)));
+      CPPUNIT_ASSERT(alarm.advance_to(unix_time(96, JUL, 4, 20, 30)));
+
+      // Triggered at 20:05 and expired at 21:06 without being seen
+      CPPUNIT_ASSERT(!alarm.advance_to(unix_time(96, JUL, 5, 12, 00)));
+      CPPUNIT_ASSERT_EQUAL(unix_time(96, JUL, 5, 20, 05), alarm.next_trigger_time(unix_time(96, JUL, 5, 12, 00)));
+   }
+
+   void AdvanceToTestSkipsWholeCycles()
+   {
+      // Every second hour at xx:05 for 30 minutes, jumping forward a year
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 2, 30);
+      CPPUNIT_ASSERT(!alarm.advance_to(unix_time(96, JUL, 4, 20, 00)));
+      CPPUNIT_ASSERT(alarm.advance_to(unix_time(96, JUL, 4, 21, 05)));
+
+      CPPUNIT_ASSERT(alarm.advance_to(unix_time(97, JUL, 4, 21, 20)));
+      CPPUNIT_ASSERT(!alarm.advance_to(unix_time(97, JUL, 4, 21, 40)));
+      CPPUNIT_ASSERT(!alarm.advance_to(unix_time(97, JUL, 4, 22, 05)));
+      CPPUNIT_ASSERT(alarm.advance_to(unix_time(97, JUL, 4, 23, 05)));
+   }
+
+   void AdvanceToTestBackwardsJumpIsSingleUpdate()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 2, 60);
+      CPPUNIT_ASSERT(!alarm.advance_to(unix_time(96, JUL, 4, 20, 05)));
+
+      // Going back to 20:05 counts the second match, just as set_current_time would
+      CPPUNIT_ASSERT(alarm.advance_to(unix_time(96, JUL, 4, 20, 05)));
+      CPPUNIT_ASSERT(alarm.advance_to(unix_time(96, JUL, 4, 19, 00)));
+   }
+
+   void UnixTimeTestWeeklyAlarmTriggersAndExpires()
+   {
+      // 4th July 1996 was a Thursday
+      TM alarm_time = s_alarm_datetime;
+      alarm_time.tm_wday = THU;
+      Alarm alarm = Alarm(INTERVAL_WEEK, &alarm_time, 1, 2);
+
+      CPPUNIT_ASSERT(!alarm.set_current_time(unix_time(96, JUL, 3, 20, 05)));
+      CPPUNIT_ASSERT(!alarm.set_current_time(unix_time(96, JUL, 4, 20, 04)));
+      CPPUNIT_ASSERT(alarm.set_current_time(unix_time(96, JUL, 4, 20, 05)));
+      CPPUNIT_ASSERT(alarm.set_current_time(unix_time(96, JUL, 4, 20, 07)));
+      CPPUNIT_ASSERT(!alarm.set_current_time(unix_time(96, JUL, 4, 20, 8)));
+      CPPUNIT_ASSERT(!alarm.set_current_time(unix_time(96, JUL, 5, 20, 05)));
+      CPPUNIT_ASSERT(alarm.set_current_time(unix_time(96, JUL, 11, 20, 05)));
+   }
+
+   void UnixTimeTestCachedMinuteMatchesConversion()
+   {
+      UNIX_TIMESTAMP time;
+      TM datetime;
+
+      // Every 7 minutes and 13 seconds for a week either side of 1st March 1996 (a leap year)
+      for (time = 825033600; time < 825033600 + (14UL * 24 * 60 * 60); time += 433)
+      {
+         seconds_to_alarm_time(time, &datetime);
+         CPPUNIT_ASSERT_EQUAL((ALARM_MINUTE)(time_to_unix_seconds(&datetime) / 60), alarm_time_to_minute(&datetime));
+      }
+   }
 };
 
 int main()
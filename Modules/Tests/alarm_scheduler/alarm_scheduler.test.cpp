@@ -0,0 +1,194 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Utility/util_time.h"
+
+#include "alarm.h"
+#include "alarm_scheduler.h"
+
+#define SCHEDULER_SIZE (8)
+
+static const TM s_alarm_datetime = {
+   0,
+   05,
+   20, // Hour
+   4, // Date
+   JUL, // Month
+   96, // Year
+   THU, //Weekday
+   185, // Day-of-year
+   0, // DST
+   0, // ignored by util_time
+   0 // ignored by util_time
+};
+
+static UNIX_TIMESTAMP unix_time(int mday, int hour, int min)
+{
+   TM tm = s_alarm_datetime;
+   tm.tm_mday = mday;
+   tm.tm_hour = hour;
+   tm.tm_min = min;
+   return time_to_unix_seconds(&tm);
+}
+
+class AlarmSchedulerTest : public CppUnit::TestFixture  {
+
+   CPPUNIT_TEST_SUITE(AlarmSchedulerTest);
+
+   CPPUNIT_TEST(SchedulerTestNothingDueBeforeDeadline);
+   CPPUNIT_TEST(SchedulerTestTriggersAtDeadline);
+   CPPUNIT_TEST(SchedulerTestExpiresAfterDuration);
+   CPPUNIT_TEST(SchedulerTestTriggersAfterRepeatCount);
+   CPPUNIT_TEST(SchedulerTestPopsInDeadlineOrder);
+   CPPUNIT_TEST(SchedulerTestRemovedAlarmIsNotPopped);
+   CPPUNIT_TEST(SchedulerTestRearmAfterDeactivation);
+   CPPUNIT_TEST(SchedulerTestPopLimitedByBuffer);
+
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+
+   void setUp(void)
+   {
+      m_scheduler = new AlarmScheduler(m_entries, SCHEDULER_SIZE);
+   }
+
+   void tearDown(void)
+   {
+      delete m_scheduler;
+   }
+
+private:
+
+   ALARM_SCHEDULE_ENTRY m_entries[SCHEDULER_SIZE];
+   AlarmScheduler * m_scheduler;
+   Alarm * m_due[SCHEDULER_SIZE];
+
+protected:
+
+   void SchedulerTestNothingDueBeforeDeadline()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 60);
+      CPPUNIT_ASSERT(m_scheduler->add(&alarm, unix_time(4, 12, 00)));
+
+      CPPUNIT_ASSERT_EQUAL(unix_time(4, 20, 05), m_scheduler->next_deadline());
+      CPPUNIT_ASSERT_EQUAL(0, m_scheduler->pop_due(unix_time(4, 20, 04), m_due, SCHEDULER_SIZE));
+      CPPUNIT_ASSERT(!alarm.is_triggered());
+   }
+
+   void SchedulerTestTriggersAtDeadline()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 60);
+      m_scheduler->add(&alarm, unix_time(4, 12, 00));
+
+      CPPUNIT_ASSERT_EQUAL(1, m_scheduler->pop_due(unix_time(4, 20, 05), m_due, SCHEDULER_SIZE));
+      CPPUNIT_ASSERT(m_due[0] == &alarm);
+      CPPUNIT_ASSERT(alarm.is_triggered());
+   }
+
+   void SchedulerTestExpiresAfterDuration()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 60);
+      m_scheduler->add(&alarm, unix_time(4, 12, 00));
+      m_scheduler->pop_due(unix_time(4, 20, 05), m_due, SCHEDULER_SIZE);
+
+      // As with set_current_time, the alarm is still triggered at the end of its duration
+      CPPUNIT_ASSERT_EQUAL(0, m_scheduler->pop_due(unix_time(4, 21, 05), m_due, SCHEDULER_SIZE));
+      CPPUNIT_ASSERT(alarm.is_triggered());
+
+      CPPUNIT_ASSERT_EQUAL(1, m_scheduler->pop_due(unix_time(4, 21, 06), m_due, SCHEDULER_SIZE));
+      CPPUNIT_ASSERT(!alarm.is_triggered());
+      CPPUNIT_ASSERT_EQUAL(unix_time(5, 20, 05), m_scheduler->next_deadline());
+   }
+
+   void SchedulerTestTriggersAfterRepeatCount()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 3, 60);
+      m_scheduler->add(&alarm, unix_time(4, 12, 00));
+
+      CPPUNIT_ASSERT_EQUAL(0, m_scheduler->pop_due(unix_time(5, 20, 05), m_due, SCHEDULER_SIZE));
+      CPPUNIT_ASSERT_EQUAL(1, m_scheduler->pop_due(unix_time(6, 20, 05), m_due, SCHEDULER_SIZE));
+      CPPUNIT_ASSERT(alarm.is_triggered());
+
+      // The next trigger is three matches after the alarm expires
+      m_scheduler->pop_due(unix_time(6, 21, 06), m_due, SCHEDULER_SIZE);
+      CPPUNIT_ASSERT_EQUAL(unix_time(9, 20, 05), m_scheduler->next_deadline());
+   }
+
+   void SchedulerTestPopsInDeadlineOrder()
+   {
+      Alarm hourly = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 10);
+      Alarm daily = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 10);
+      Alarm weekly = Alarm(INTERVAL_WEEK, &s_alarm_datetime, 1, 10);
+
+      m_scheduler->add(&weekly, unix_time(4, 12, 00));
+      m_scheduler->add(&daily, unix_time(4, 12, 00));
+      m_scheduler->add(&hourly, unix_time(4, 12, 00));
+
+      CPPUNIT_ASSERT_EQUAL(1, m_scheduler->pop_due(unix_time(4, 12, 05), m_due, SCHEDULER_SIZE));
+      CPPUNIT_ASSERT(m_due[0] == &hourly);
+      CPPUNIT_ASSERT_EQUAL(unix_time(4, 12, 16), m_scheduler->next_deadline());
+   }
+
+   void SchedulerTestRemovedAlarmIsNotPopped()
+   {
+      Alarm hourly = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 10);
+      Alarm daily = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 10);
+
+      m_scheduler->add(&hourly, unix_time(4, 12, 00));
+      m_scheduler->add(&daily, unix_time(4, 12, 00));
+      CPPUNIT_ASSERT(m_scheduler->remove(&hourly));
+      CPPUNIT_ASSERT(!m_scheduler->remove(&hourly));
+
+      CPPUNIT_ASSERT_EQUAL(1, m_scheduler->count());
+      CPPUNIT_ASSERT_EQUAL(unix_time(4, 20, 05), m_scheduler->next_deadline());
+   }
+
+   void SchedulerTestRearmAfterDeactivation()
+   {
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 30);
+      m_scheduler->add(&alarm, unix_time(4, 12, 00));
+      m_scheduler->pop_due(unix_time(4, 12, 05), m_due, SCHEDULER_SIZE);
+
+      alarm.deactivate();
+      CPPUNIT_ASSERT(m_scheduler->rearm(&alarm, unix_time(4, 12, 10)));
+      CPPUNIT_ASSERT_EQUAL(unix_time(4, 13, 05), m_scheduler->next_deadline());
+   }
+
+   void SchedulerTestPopLimitedByBuffer()
+   {
+      Alarm a = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 10);
+      Alarm b = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 10);
+
+      m_scheduler->add(&a, unix_time(4, 12, 00));
+      m_scheduler->add(&b, unix_time(4, 12, 00));
+
+      CPPUNIT_ASSERT_EQUAL(1, m_scheduler->pop_due(unix_time(4, 12, 05), m_due, 1));
+      CPPUNIT_ASSERT_EQUAL(1, m_scheduler->pop_due(unix_time(4, 12, 05), m_due, 1));
+      CPPUNIT_ASSERT(a.is_triggered() && b.is_triggered());
+   }
+};
+
+int main()
+{
+   CppUnit::TextUi::TestRunner runner;
+
+   CPPUNIT_TEST_SUITE_REGISTRATION( AlarmSchedulerTest );
+
+   CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+
+   runner.addTest( registry.makeTest() );
+   runner.run();
+
+   return 0;
+}
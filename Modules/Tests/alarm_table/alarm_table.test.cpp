@@ -0,0 +1,178 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Utility/util_time.h"
+
+#include "alarm.h"
+#include "alarm_table.h"
+
+static const TM s_alarm_datetime = {
+   0,
+   05,
+   20, // Hour
+   4, // Date
+   JUL, // Month
+   96, // Year
+   SUN, //Weekday
+   185, // Day-of-year
+   0, // DST
+   0, // ignored by util_time
+   0 // ignored by util_time
+};
+
+static const INTERVAL s_intervals[] = {INTERVAL_HOUR, INTERVAL_DAY, INTERVAL_WEEK, INTERVAL_MONTH, INTERVAL_YEAR};
+
+class AlarmTableTest : public CppUnit::TestFixture  {
+
+   CPPUNIT_TEST_SUITE(AlarmTableTest);
+
+   CPPUNIT_TEST(TableTestEmptySlotsNeverTrigger);
+   CPPUNIT_TEST(TableTestRejectsUnrepresentableRepeat);
+   CPPUNIT_TEST(TableTestTriggersAndExpires);
+   CPPUNIT_TEST(TableTestDeactivatedIsNotRetriggered);
+   CPPUNIT_TEST(TableTestMatchesAlarmForEveryIntervalAndSlot);
+
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+
+   void setUp(void)
+   {
+      m_table = new AlarmTable();
+   }
+
+   void tearDown(void)
+   {
+      delete m_table;
+   }
+
+private:
+
+   AlarmTable * m_table;
+
+protected:
+
+   void TableTestEmptySlotsNeverTrigger()
+   {
+      TM datetime = s_alarm_datetime;
+      int i;
+
+      for (datetime.tm_min = 0; datetime.tm_min < 60; datetime.tm_min++)
+      {
+         m_table->set_current_time(&datetime);
+      }
+
+      for (i = 0; i < ALARM_TABLE_SIZE; ++i)
+      {
+         CPPUNIT_ASSERT(!m_table->is_triggered(i));
+      }
+   }
+
+   void TableTestRejectsUnrepresentableRepeat()
+   {
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 256, 60);
+      CPPUNIT_ASSERT(!m_table->set(0, &alarm));
+
+      alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 60);
+      CPPUNIT_ASSERT(!m_table->set(ALARM_TABLE_SIZE, &alarm));
+      CPPUNIT_ASSERT(m_table->set(ALARM_TABLE_SIZE-1, &alarm));
+   }
+
+   void TableTestTriggersAndExpires()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 30);
+      CPPUNIT_ASSERT(m_table->set(33, &alarm));
+
+      TM datetime = s_alarm_datetime;
+      m_table->set_current_time(&datetime);
+      CPPUNIT_ASSERT(m_table->is_triggered(33));
+      CPPUNIT_ASSERT(!m_table->is_triggered(32));
+
+      datetime.tm_min += 30;
+      m_table->set_current_time(&datetime);
+      CPPUNIT_ASSERT(m_table->is_triggered(33));
+
+      datetime.tm_min++;
+      m_table->set_current_time(&datetime);
+      CPPUNIT_ASSERT(!m_table->is_triggered(33));
+   }
+
+   void TableTestDeactivatedIsNotRetriggered()
+   {
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 60);
+      m_table->set(0, &alarm);
+
+      TM datetime = s_alarm_datetime;
+      m_table->set_current_time(&datetime);
+      m_table->deactivate(0);
+
+      datetime.tm_min++;
+      m_table->set_current_time(&datetime);
+      CPPUNIT_ASSERT(!m_table->is_triggered(0));
+   }
+
+   void TableTestMatchesAlarmForEveryIntervalAndSlot()
+   {
+      Alarm alarms[ALARM_TABLE_SIZE];
+      int i;
+      int tick;
+
+      srand(1);
+
+      for (i = 0; i < ALARM_TABLE_SIZE; ++i)
+      {
+         TM alarm_time = s_alarm_datetime;
+         alarm_time.tm_min = rand() % 4;
+         alarm_time.tm_hour = rand() % 2;
+         alarm_time.tm_mday = 1 + (rand() % 2);
+         alarm_time.tm_mon = rand() % 2;
+         alarm_time.tm_wday = rand() % 2;
+         alarms[i] = Alarm(s_intervals[i % 5], &alarm_time, 1 + (rand() % 3), 1 + (rand() % 5));
+         CPPUNIT_ASSERT(m_table->set(i, &alarms[i]));
+      }
+
+      // Walk the fields independently (not a real calendar) so every combination is seen
+      for (tick = 0; tick < 5000; ++tick)
+      {
+         TM datetime = s_alarm_datetime;
+         datetime.tm_min = rand() % 4;
+         datetime.tm_hour = rand() % 2;
+         datetime.tm_mday = 1 + (rand() % 2);
+         datetime.tm_mon = rand() % 2;
+         datetime.tm_wday = rand() % 2;
+         datetime.tm_year = 96 + (tick / 1000);
+         datetime.tm_yday = tick % 365;
+
+         m_table->set_current_time(&datetime);
+
+         for (i = 0; i < ALARM_TABLE_SIZE; ++i)
+         {
+            CPPUNIT_ASSERT_EQUAL(alarms[i].set_current_time(&datetime), m_table->is_triggered(i));
+         }
+      }
+   }
+};
+
+int main()
+{
+   CppUnit::TextUi::TestRunner runner;
+
+   CPPUNIT_TEST_SUITE_REGISTRATION( AlarmTableTest );
+
+   CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+
+   runner.addTest( registry.makeTest() );
+   runner.run();
+
+   return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Utility/util_time.h"
+
+#include "alarm.h"
+#include "alarm_wheel.h"
+
+#define MAX_DUE (8)
+
+static const TM s_alarm_datetime = {
+   0,
+   05,
+   20, // Hour
+   4, // Date
+   JUL, // Month
+   96, // Year
+   THU, //Weekday
+   185, // Day-of-year
+   0, // DST
+   0, // ignored by util_time
+   0 // ignored by util_time
+};
+
+static UNIX_TIMESTAMP unix_time(int year, int mon, int mday, int hour, int min)
+{
+   TM tm = s_alarm_datetime;
+   tm.tm_year = year;
+   tm.tm_mon = mon;
+   tm.tm_mday = mday;
+   tm.tm_hour = hour;
+   tm.tm_min = min;
+   return time_to_unix_seconds(&tm);
+}
+
+class AlarmWheelTest : public CppUnit::TestFixture  {
+
+   CPPUNIT_TEST_SUITE(AlarmWheelTest);
+
+   CPPUNIT_TEST(WheelTestNothingDueBeforeDeadline);
+   CPPUNIT_TEST(WheelTestTriggersAndExpiresWithinHour);
+   CPPUNIT_TEST(WheelTestCascadesFromDayWheel);
+   CPPUNIT_TEST(WheelTestCascadesFromMonthWheel);
+   CPPUNIT_TEST(WheelTestCascadesFromOverflow);
+   CPPUNIT_TEST(WheelTestSharedDeadlineExpiresTogether);
+   CPPUNIT_TEST(WheelTestRemovedAlarmIsNotDue);
+   CPPUNIT_TEST(WheelTestAdvanceLimitedByBuffer);
+
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+
+   void setUp(void)
+   {
+      m_wheel = new AlarmWheel(unix_time(96, JUL, 4, 12, 00));
+   }
+
+   void tearDown(void)
+   {
+      delete m_wheel;
+   }
+
+private:
+
+   AlarmWheel * m_wheel;
+   ALARM_WHEEL_NODE m_nodes[MAX_DUE];
+   Alarm * m_due[MAX_DUE];
+
+protected:
+
+   void WheelTestNothingDueBeforeDeadline()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 60);
+      m_wheel->add(&m_nodes[0], &alarm);
+
+      CPPUNIT_ASSERT_EQUAL(0, m_wheel->advance(unix_time(96, JUL, 4, 20, 04), m_due, MAX_DUE));
+      CPPUNIT_ASSERT(!alarm.is_triggered());
+   }
+
+   void WheelTestTriggersAndExpiresWithinHour()
+   {
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 30);
+      m_wheel->add(&m_nodes[0], &alarm);
+
+      CPPUNIT_ASSERT_EQUAL(1, m_wheel->advance(unix_time(96, JUL, 4, 12, 05), m_due, MAX_DUE));
+      CPPUNIT_ASSERT(m_due[0] == &alarm);
+      CPPUNIT_ASSERT(alarm.is_triggered());
+
+      CPPUNIT_ASSERT_EQUAL(0, m_wheel->advance(unix_time(96, JUL, 4, 12, 35), m_due, MAX_DUE));
+      CPPUNIT_ASSERT_EQUAL(1, m_wheel->advance(unix_time(96, JUL, 4, 12, 36), m_due, MAX_DUE));
+      CPPUNIT_ASSERT(!alarm.is_triggered());
+   }
+
+   void WheelTestCascadesFromDayWheel()
+   {
+      Alarm alarm = Alarm(INTERVAL_DAY, &s_alarm_datetime, 3, 60);
+      m_wheel->add(&m_nodes[0], &alarm);
+
+      CPPUNIT_ASSERT_EQUAL(0, m_wheel->advance(unix_time(96, JUL, 6, 20, 04), m_due, MAX_DUE));
+      CPPUNIT_ASSERT_EQUAL(1, m_wheel->advance(unix_time(96, JUL, 6, 20, 05), m_due, MAX_DUE));
+      CPPUNIT_ASSERT(alarm.is_triggered());
+   }
+
+   void WheelTestCascadesFromMonthWheel()
+   {
+      Alarm alarm = Alarm(INTERVAL_MONTH, &s_alarm_datetime, 2, 60);
+      m_wheel->add(&m_nodes[0], &alarm);
+
+      // Counts 4th July, triggers on 4th August
+      CPPUNIT_ASSERT_EQUAL(0, m_wheel->advance(unix_time(96, AUG, 4, 20, 04), m_due, MAX_DUE));
+      CPPUNIT_ASSERT_EQUAL(1, m_wheel->advance(unix_time(96, AUG, 4, 20, 05), m_due, MAX_DUE));
+      CPPUNIT_ASSERT(alarm.is_triggered());
+   }
+
+   void WheelTestCascadesFromOverflow()
+   {
+      Alarm alarm = Alarm(INTERVAL_YEAR, &s_alarm_datetime, 2, 60);
+      m_wheel->add(&m_nodes[0], &alarm);
+
+      CPPUNIT_ASSERT_EQUAL(0, m_wheel->advance(unix_time(97, JUL, 4, 20, 04), m_due, MAX_DUE));
+      CPPUNIT_ASSERT_EQUAL(1, m_wheel->advance(unix_time(97, JUL, 4, 20, 05), m_due, MAX_DUE));
+      CPPUNIT_ASSERT(alarm.is_triggered());
+   }
+
+   void WheelTestSharedDeadlineExpiresTogether()
+   {
+      Alarm hourly = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 10);
+      Alarm daily = Alarm(INTERVAL_DAY, &s_alarm_datetime, 1, 10);
+      TM weekly_time = s_alarm_datetime;
+      weekly_time.tm_wday = THU;
+      Alarm weekly = Alarm(INTERVAL_WEEK, &weekly_time, 1, 10);
+
+      m_wheel->add(&m_nodes[0], &hourly);
+      m_wheel->add(&m_nodes[1], &daily);
+      m_wheel->add(&m_nodes[2], &weekly);
+
+      // The hourly alarm triggers and expires each hour before then
+      while (m_wheel->advance(unix_time(96, JUL, 4, 19, 59), m_due, MAX_DUE) == MAX_DUE) {}
+      CPPUNIT_ASSERT_EQUAL(3, m_wheel->advance(unix_time(96, JUL, 4, 20, 05), m_due, MAX_DUE));
+      CPPUNIT_ASSERT(hourly.is_triggered() && daily.is_triggered() && weekly.is_triggered());
+   }
+
+   void WheelTestRemovedAlarmIsNotDue()
+   {
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 10);
+      m_wheel->add(&m_nodes[0], &alarm);
+      m_wheel->remove(&m_nodes[0]);
+
+      CPPUNIT_ASSERT_EQUAL(0, m_wheel->count());
+      CPPUNIT_ASSERT_EQUAL(0, m_wheel->advance(unix_time(96, JUL, 4, 13, 05), m_due, MAX_DUE));
+      CPPUNIT_ASSERT(!alarm.is_triggered());
+   }
+
+   void WheelTestAdvanceLimitedByBuffer()
+   {
+      Alarm a = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 10);
+      Alarm b = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 10);
+
+      m_wheel->add(&m_nodes[0], &a);
+      m_wheel->add(&m_nodes[1], &b);
+
+      CPPUNIT_ASSERT_EQUAL(1, m_wheel->advance(unix_time(96, JUL, 4, 12, 05), m_due, 1));
+      CPPUNIT_ASSERT_EQUAL(1, m_wheel->advance(unix_time(96, JUL, 4, 12, 05), m_due, 1));
+      CPPUNIT_ASSERT(a.is_triggered() && b.is_triggered());
+   }
+};
+
+int main()
+{
+   CppUnit::TextUi::TestRunner runner;
+
+   CPPUNIT_TEST_SUITE_REGISTRATION( AlarmWheelTest );
+
+   CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+
+   runner.addTest( registry.makeTest() );
+   runner.run();
+
+   return 0;
+}
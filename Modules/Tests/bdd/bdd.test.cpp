@@ -0,0 +1,164 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "ast_node.h"
+#include "syntax_parser.h"
+#include "bdd.h"
+
+#define MAX_TEST_NODES (64)
+#define TEST_FUNCTIONS (6)
+
+static bool s_inputs[TEST_FUNCTIONS];
+static int s_calls = 0;
+
+template <int FID> static bool fInput(void) { s_calls++; return s_inputs[FID]; }
+
+class BDDTest : public CppUnit::TestFixture  {
+
+   CPPUNIT_TEST_SUITE(BDDTest);
+
+   CPPUNIT_TEST(EquivalentExpressionsShareARoot);
+   CPPUNIT_TEST(ConstantExpressionsAreTerminals);
+   CPPUNIT_TEST(EvaluateMatchesTree);
+   CPPUNIT_TEST(PoolExhaustionIsReported);
+
+   CPPUNIT_TEST_SUITE_END();
+
+public:
+
+   void setUp(void)
+   {
+      BDD_Init();
+   }
+
+   void tearDown(void)
+   {
+
+   }
+
+private:
+
+   BDDREF bdd(char const * text)
+   {
+      Parser parser;
+      ASTNode nodes[MAX_TEST_NODES];
+      ASTArena arena;
+      AST_InitArena(&arena, nodes, MAX_TEST_NODES);
+
+      ASTNode * pNode = LEP_Parse(&parser, text, &arena);
+      CPPUNIT_ASSERT_MESSAGE(LEP_GetErrorMessage(&parser), parser.m_success);
+      return BDD_FromAST(pNode);
+   }
+
+protected:
+
+   void EquivalentExpressionsShareARoot()
+   {
+      CPPUNIT_ASSERT_EQUAL(bdd("0&(1|2)"), bdd("(2&0)|(0&1)"));
+      CPPUNIT_ASSERT_EQUAL(bdd("!(0|1)"), bdd("!1&!0"));
+      CPPUNIT_ASSERT(bdd("0&1") != bdd("0|1"));
+
+      // Building the same expression again takes no new nodes
+      uint16_t used = BDD_NodesUsed();
+      bdd("(1|2)&0");
+      CPPUNIT_ASSERT_EQUAL(used, BDD_NodesUsed());
+   }
+
+   void ConstantExpressionsAreTerminals()
+   {
+      CPPUNIT_ASSERT_EQUAL((BDDREF)BDD_TRUE, bdd("0|!0"));
+      CPPUNIT_ASSERT_EQUAL((BDDREF)BDD_FALSE, bdd("1&!1"));
+      CPPUNIT_ASSERT_EQUAL((BDDREF)BDD_TRUE, bdd("(0&1)|!0|!1"));
+      CPPUNIT_ASSERT_EQUAL((BDDREF)BDD_FALSE, bdd("2&F"));
+   }
+
+   void EvaluateMatchesTree()
+   {
+      static char const * const expressions[] = {"(0&!1)|(2&3)&!(4|5)", "0|1|2|3|4|5", "!(0&1)&(2|!3)"};
+      Parser parser;
+      int i;
+      int combination;
+      int fid;
+
+      for (i = 0; i < 3; ++i)
+      {
+         ASTNode * pNode = LEP_Parse(&parser, expressions[i], NULL);
+         BDDREF root = BDD_FromAST(pNode);
+         CPPUNIT_ASSERT(root != BDD_INVALID);
+
+         for (combination = 0; combination < (1 << TEST_FUNCTIONS); ++combination)
+         {
+            for (fid = 0; fid < TEST_FUNCTIONS; ++fid) { s_inputs[fid] = (combination >> fid) & 1; }
+
+            bool expected = LEP_Evaluate(pNode);
+            s_calls = 0;
+            CPPUNIT_ASSERT_EQUAL(expected, BDD_Evaluate(root));
+            CPPUNIT_ASSERT(s_calls <= TEST_FUNCTIONS);
+         }
+      }
+   }
+
+   void PoolExhaustionIsReported()
+   {
+      // Each pair of functions ANDed and ORed needs its own nodes
+      char text[8];
+      BDDREF first = bdd("0&1");
+      BDDREF root = first;
+      int i;
+      int j;
+
+      for (i = 0; (i < 20) && (root != BDD_INVALID); ++i)
+      {
+         for (j = i + 1; (j < 20) && (root != BDD_INVALID); ++j)
+         {
+            snprintf(text, sizeof(text), "%d&%d", i, j);
+            root = bdd(text);
+            if (root == BDD_INVALID) { break; }
+            snprintf(text, sizeof(text), "%d|%d", i, j);
+            root = bdd(text);
+         }
+      }
+
+      CPPUNIT_ASSERT_EQUAL((BDDREF)BDD_INVALID, root);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)BDD_MAX_NODES, BDD_NodesUsed());
+
+      // Existing diagrams are unaffected
+      CPPUNIT_ASSERT_EQUAL(first, bdd("1&0"));
+
+      BDD_Init();
+      CPPUNIT_ASSERT(bdd("18|19") != BDD_INVALID);
+   }
+};
+
+int main()
+{
+   LEP_Init();
+
+   LEP_RegisterFunction(0, fInput<0>);
+   LEP_RegisterFunction(1, fInput<1>);
+   LEP_RegisterFunction(2, fInput<2>);
+   LEP_RegisterFunction(3, fInput<3>);
+   LEP_RegisterFunction(4, fInput<4>);
+   LEP_RegisterFunction(5, fInput<5>);
+
+   CppUnit::TextUi::TestRunner runner;
+
+   CPPUNIT_TEST_SUITE_REGISTRATION( BDDTest );
+
+   CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+
+   runner.addTest( registry.makeTest() );
+   runner.run();
+
+   return 0;
+}
@@ -0,0 +1,399 @@
+/*
+ * bench_alarm
+ *
+ * Simulates minute ticks over a number of years for a mix of alarms, once for each
+ * way of holding them, and reports the cost per tick as JSON on stdout:
+ *
+ *    bench_alarm [years] [alarms] [seed]
+ *
+ * Modes:
+ *    scan       Alarm::set_current_time(TM) on every alarm (the TM is converted once per tick)
+ *    scan_unix  Alarm::set_current_time(UNIX_TIMESTAMP) on every alarm
+ *    packed     PackedAlarm::set_current_time(UNIX_TIMESTAMP) on every alarm
+ *    packed_tm  PackedAlarm::set_current_time(TM) on every alarm (the TM is converted once per tick)
+ *    table      AlarmTable::set_current_time, ALARM_TABLE_SIZE alarms per table
+ *    scheduler  AlarmScheduler::pop_due
+ *    wheel      AlarmWheel::advance
+ *
+ * state_changes counts every triggered/untriggered transition, so should be equal for all modes.
+ */
+
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifdef TEST
+#include <cppunit/TestAssert.h>
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define BENCH_HAS_TSC
+#endif
+
+/*
+ * Code Library Includes
+ */
+
+#include "Utility/util_time.h"
+
+/*
+ * Application Includes
+ */
+
+#include "alarm.h"
+#include "packed_alarm.h"
+#include "alarm_table.h"
+#include "alarm_scheduler.h"
+#include "alarm_wheel.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define DEFAULT_YEARS (1)
+#define DEFAULT_ALARMS (64)
+#define DEFAULT_SEED (1)
+
+#define MINUTES_PER_YEAR (365UL * 24 * 60)
+#define MAX_DUE (64)
+
+static const UNIX_TIMESTAMP s_start_time = 946684800; // 1st January 2000
+
+static const INTERVAL s_intervals[] = {INTERVAL_HOUR, INTERVAL_DAY, INTERVAL_WEEK, INTERVAL_MONTH, INTERVAL_YEAR};
+
+struct bench_result
+{
+   char const * mode;
+   double seconds;
+   uint64_t cycles;
+   unsigned long state_changes;
+};
+typedef struct bench_result BENCH_RESULT;
+
+/*
+ * Private Functions
+ */
+
+static double now_seconds()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static uint64_t now_cycles()
+{
+#ifdef BENCH_HAS_TSC
+   return __rdtsc();
+#else
+   return 0;
+#endif
+}
+
+static void start(BENCH_RESULT * result, char const * mode)
+{
+   result->mode = mode;
+   result->state_changes = 0;
+   result->seconds = now_seconds();
+   result->cycles = now_cycles();
+}
+
+static void stop(BENCH_RESULT * result)
+{
+   result->cycles = now_cycles() - result->cycles;
+   result->seconds = now_seconds() - result->seconds;
+}
+
+static void make_alarms(Alarm * alarms, int n_alarms)
+{
+   int i;
+   for (i = 0; i < n_alarms; ++i)
+   {
+      TM alarm_time;
+      set_default_alarm_time(&alarm_time);
+      alarm_time.tm_min = rand() % 60;
+      alarm_time.tm_hour = rand() % 24;
+      alarm_time.tm_mday = 1 + (rand() % 28);
+      alarm_time.tm_mon = rand() % 12;
+      alarm_time.tm_wday = rand() % 7;
+
+      alarms[i] = Alarm(s_intervals[i % 5], &alarm_time, 1 + (rand() % 5), 1 + (rand() % 120));
+   }
+}
+
+static void bench_scan(BENCH_RESULT * result, Alarm const * config, int n_alarms, unsigned long ticks)
+{
+   Alarm * alarms = new Alarm[n_alarms];
+   bool * triggered = new bool[n_alarms]();
+   unsigned long tick;
+   int i;
+
+   memcpy(alarms, config, n_alarms * sizeof(Alarm));
+
+   start(result, "scan");
+   for (tick = 0; tick < ticks; ++tick)
+   {
+      TM now;
+      seconds_to_alarm_time(s_start_time + (tick * 60), &now);
+
+      for (i = 0; i < n_alarms; ++i)
+      {
+         bool state = alarms[i].set_current_time(&now);
+         result->state_changes += (state != triggered[i]);
+         triggered[i] = state;
+      }
+   }
+   stop(result);
+
+   delete [] triggered;
+   delete [] alarms;
+}
+
+static void bench_scan_unix(BENCH_RESULT * result, Alarm const * config, int n_alarms, unsigned long ticks)
+{
+   Alarm * alarms = new Alarm[n_alarms];
+   bool * triggered = new bool[n_alarms]();
+   unsigned long tick;
+   int i;
+
+   memcpy(alarms, config, n_alarms * sizeof(Alarm));
+
+   start(result, "scan_unix");
+   for (tick = 0; tick < ticks; ++tick)
+   {
+      UNIX_TIMESTAMP now = s_start_time + (tick * 60);
+
+      for (i = 0; i < n_alarms; ++i)
+      {
+         bool state = alarms[i].set_current_time(now);
+         result->state_changes += (state != triggered[i]);
+         triggered[i] = state;
+      }
+   }
+   stop(result);
+
+   delete [] triggered;
+   delete [] alarms;
+}
+
+static void bench_packed(BENCH_RESULT * result, Alarm const * config, int n_alarms, unsigned long ticks)
+{
+   PackedAlarm * alarms = new PackedAlarm[n_alarms];
+   bool * triggered = new bool[n_alarms]();
+   unsigned long tick;
+   int i;
+
+   for (i = 0; i < n_alarms; ++i) { (void)alarms[i].from_alarm(&config[i]); }
+
+   start(result, "packed");
+   for (tick = 0; tick < ticks; ++tick)
+   {
+      UNIX_TIMESTAMP now = s_start_time + (tick * 60);
+
+      for (i = 0; i < n_alarms; ++i)
+      {
+         bool state = alarms[i].set_current_time(now);
+         result->state_changes += (state != triggered[i]);
+         triggered[i] = state;
+      }
+   }
+   stop(result);
+
+   delete [] triggered;
+   delete [] alarms;
+}
+
+static void bench_packed_tm(BENCH_RESULT * result, Alarm const * config, int n_alarms, unsigned long ticks)
+{
+   PackedAlarm * alarms = new PackedAlarm[n_alarms];
+   bool * triggered = new bool[n_alarms]();
+   unsigned long tick;
+   int i;
+
+   for (i = 0; i < n_alarms; ++i) { (void)alarms[i].from_alarm(&config[i]); }
+
+   start(result, "packed_tm");
+   for (tick = 0; tick < ticks; ++tick)
+   {
+      TM now;
+      seconds_to_alarm_time(s_start_time + (tick * 60), &now);
+
+      for (i = 0; i < n_alarms; ++i)
+      {
+         bool state = alarms[i].set_current_time(&now);
+         result->state_changes += (state != triggered[i]);
+         triggered[i] = state;
+      }
+   }
+   stop(result);
+
+   delete [] triggered;
+   delete [] alarms;
+}
+
+static void bench_table(BENCH_RESULT * result, Alarm const * config, int n_alarms, unsigned long ticks)
+{
+   int n_tables = (n_alarms + ALARM_TABLE_SIZE - 1) / ALARM_TABLE_SIZE;
+   int n_blocks = n_tables * ALARM_TABLE_BLOCKS;
+   AlarmTable * tables = new AlarmTable[n_tables];
+   uint32_t * triggered = new uint32_t[n_blocks]();
+   unsigned long tick;
+   int i;
+
+   for (i = 0; i < n_alarms; ++i) { (void)tables[i / ALARM_TABLE_SIZE].set(i % ALARM_TABLE_SIZE, &config[i]); }
+
+   start(result, "table");
+   for (tick = 0; tick < ticks; ++tick)
+   {
+      TM now;
+      seconds_to_alarm_time(s_start_time + (tick * 60), &now);
+
+      for (i = 0; i < n_tables; ++i) { tables[i].set_current_time(&now); }
+
+      for (i = 0; i < n_blocks; ++i)
+      {
+         uint32_t state = tables[i / ALARM_TABLE_BLOCKS].triggered_block(i % ALARM_TABLE_BLOCKS);
+         result->state_changes += __builtin_popcount(state ^ triggered[i]);
+         triggered[i] = state;
+      }
+   }
+   stop(result);
+
+   delete [] triggered;
+   delete [] tables;
+}
+
+static void bench_scheduler(BENCH_RESULT * result, Alarm const * config, int n_alarms, unsigned long ticks)
+{
+   Alarm * alarms = new Alarm[n_alarms];
+   ALARM_SCHEDULE_ENTRY * entries = new ALARM_SCHEDULE_ENTRY[n_alarms];
+   AlarmScheduler scheduler(entries, n_alarms);
+   Alarm * due[MAX_DUE];
+   unsigned long tick;
+   int i;
+   int n_due;
+
+   memcpy(alarms, config, n_alarms * sizeof(Alarm));
+   for (i = 0; i < n_alarms; ++i) { (void)scheduler.add(&alarms[i], s_start_time); }
+
+   start(result, "scheduler");
+   for (tick = 0; tick < ticks; ++tick)
+   {
+      UNIX_TIMESTAMP now = s_start_time + (tick * 60);
+
+      do
+      {
+         n_due = scheduler.pop_due(now, due, MAX_DUE);
+         result->state_changes += n_due;
+      } while (n_due == MAX_DUE);
+   }
+   stop(result);
+
+   delete [] entries;
+   delete [] alarms;
+}
+
+static void bench_wheel(BENCH_RESULT * result, Alarm const * config, int n_alarms, unsigned long ticks)
+{
+   Alarm * alarms = new Alarm[n_alarms];
+   ALARM_WHEEL_NODE * nodes = new ALARM_WHEEL_NODE[n_alarms];
+   AlarmWheel * wheel = new AlarmWheel(s_start_time);
+   Alarm * due[MAX_DUE];
+   unsigned long tick;
+   int i;
+   int n_due;
+
+   memcpy(alarms, config, n_alarms * sizeof(Alarm));
+   for (i = 0; i < n_alarms; ++i) { wheel->add(&nodes[i], &alarms[i]); }
+
+   start(result, "wheel");
+   for (tick = 0; tick < ticks; ++tick)
+   {
+      UNIX_TIMESTAMP now = s_start_time + (tick * 60);
+
+      do
+      {
+         n_due = wheel->advance(now, due, MAX_DUE);
+         result->state_changes += n_due;
+      } while (n_due == MAX_DUE);
+   }
+   stop(result);
+
+   delete wheel;
+   delete [] nodes;
+   delete [] alarms;
+}
+
+static void print_result(BENCH_RESULT const * result, int n_alarms, unsigned long ticks, bool last)
+{
+   double ns_per_tick = (result->seconds * 1e9) / ticks;
+   double ticks_per_sec = ticks / result->seconds;
+
+   printf("    {\"mode\": \"%s\", \"seconds\": %.6f, \"ns_per_tick\": %.3f, \"ticks_per_sec\": %.1f, ",
+      result->mode, result->seconds, ns_per_tick, ticks_per_sec);
+
+#ifdef BENCH_HAS_TSC
+   printf("\"cycles_per_alarm_check\": %.3f, ", (double)result->cycles / ((double)ticks * n_alarms));
+#else
+   (void)n_alarms;
+   printf("\"cycles_per_alarm_check\": null, ");
+#endif
+
+   printf("\"state_changes\": %lu}%s\n", result->state_changes, last ? "" : ",");
+}
+
+/*
+ * Public Functions
+ */
+
+int main(int argc, char ** argv)
+{
+   int years = (argc > 1) ? atoi(argv[1]) : DEFAULT_YEARS;
+   int n_alarms = (argc > 2) ? atoi(argv[2]) : DEFAULT_ALARMS;
+   int seed = (argc > 3) ? atoi(argv[3]) : DEFAULT_SEED;
+
+   if ((years < 1) || (n_alarms < 1))
+   {
+      fprintf(stderr, "usage: %s [years] [alarms] [seed]\n", argv[0]);
+      return 1;
+   }
+
+   unsigned long ticks = years * MINUTES_PER_YEAR;
+   Alarm * config = new Alarm[n_alarms];
+   BENCH_RESULT results[7];
+   int n_results = 0;
+   int i;
+
+   srand(seed);
+   make_alarms(config, n_alarms);
+
+   bench_scan(&results[n_results++], config, n_alarms, ticks);
+   bench_scan_unix(&results[n_results++], config, n_alarms, ticks);
+   bench_packed(&results[n_results++], config, n_alarms, ticks);
+   bench_packed_tm(&results[n_results++], config, n_alarms, ticks);
+   bench_table(&results[n_results++], config, n_alarms, ticks);
+   bench_scheduler(&results[n_results++], config, n_alarms, ticks);
+   bench_wheel(&results[n_results++], config, n_alarms, ticks);
+
+   printf("{\n");
+   printf("  \"benchmark\": \"bench_alarm\",\n");
+   printf("  \"years\": %d,\n  \"alarms\": %d,\n  \"seed\": %d,\n  \"ticks\": %lu,\n", years, n_alarms, seed, ticks);
+   printf("  \"results\": [\n");
+   for (i = 0; i < n_results; ++i)
+   {
+      print_result(&results[i], n_alarms, ticks, i == (n_results - 1));
+   }
+   printf("  ]\n}\n");
+
+   delete [] config;
+
+   return 0;
+}
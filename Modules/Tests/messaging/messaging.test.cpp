@@ -25,7 +25,7 @@
 static bool set_rtc_callback(TM* tm);
 static bool set_alarm_callback(int alarm_id, Alarm * pAlarm);
 static bool clr_alarm_callback(int alarm_id);
-static bool set_trigger_callback(int io_index, char * pTriggerExpression);
+static bool set_trigger_callback(int io_index, char const * pTriggerExpression, size_t length);
 static bool clear_trigger_callback(int io_index);
 static bool set_io_type_callback(int io_index, IO_TYPE io_type);
 static bool reset_callback(void);
@@ -73,6 +73,9 @@ class MessagingTest : public CppUnit::TestFixture  {
    CPPUNIT_TEST(SetIOTypeInvalidMessageTest);
    CPPUNIT_TEST(ReadInputMessageTest);
    CPPUNIT_TEST(ResetMessageTest);
+   CPPUNIT_TEST(LengthAwareMessageTest);
+   CPPUNIT_TEST(BatchMessageTest);
+   CPPUNIT_TEST(AllOrNothingBatchMessageTest);
    CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -99,9 +102,9 @@ public:
       return true;
    }
 
-   bool Set_trigger_callback(int io_index, char * pTriggerExpression)
+   bool Set_trigger_callback(int io_index, char const * pTriggerExpression, size_t length)
    {
-      m_trigger = std::string(pTriggerExpression);
+      m_trigger = std::string(pTriggerExpression, length);
       m_io_trigger = io_index;
       m_callback_flags[MSG_ID_IDX(MSG_SET_TRIGGER)] = true;
       return true;
@@ -227,6 +230,8 @@ private:
 
    void clear_reply() { m_reply[0] = '\0'; }
 
+   bool handle_frame(char const * frame) { return m_message_handler->handle_message(frame, strlen(frame)); }
+
    void assert_message_passes_on_handling(bool message_callback_expected, std::string * expected_reply = NULL)
    {
       char id = m_message[0];
@@ -560,6 +565,13 @@ protected:
       build_message(MSG_SET_TRIGGER, "4 1&2|A1");
       assert_message_passes_on_handling(true);
       CPPUNIT_ASSERT_EQUAL(std::string("1&2|A1"), m_trigger);
+
+      // Expressions are not limited by the reply buffer size
+      char const * long_trigger = "E2 (1&2)|(3&4)|(5&6)|(7&8)|(9&10)|!11";
+      CPPUNIT_ASSERT(strlen(long_trigger) > MAX_MESSAGE_LENGTH);
+      CPPUNIT_ASSERT(handle_frame(long_trigger));
+      CPPUNIT_ASSERT_EQUAL(std::string(&long_trigger[3]), m_trigger);
+      CPPUNIT_ASSERT_EQUAL(2, m_io_trigger);
    }
 
    void ClearTriggerMessageTest()
@@ -627,6 +639,77 @@ protected:
 
       assert_message_passes_on_handling(true, &expected);
    }
+
+   void LengthAwareMessageTest()
+   {
+      // Nothing past the given length is read
+      char const frame[] = "E2 1&2|A1;D01";
+      CPPUNIT_ASSERT(m_message_handler->handle_message(frame, 9));
+      CPPUNIT_ASSERT_EQUAL(std::string("1&2|A1"), m_trigger);
+      CPPUNIT_ASSERT_EQUAL(2, m_io_trigger);
+      assert_valid_reply(MSG_SET_TRIGGER);
+
+      char const clear[] = "D01";
+      CPPUNIT_ASSERT(!m_message_handler->handle_message(clear, 2));
+      assert_invalid_reply(MSG_CLEAR_ALARM);
+      CPPUNIT_ASSERT(m_message_handler->handle_message(clear, 3));
+      CPPUNIT_ASSERT_EQUAL(1, m_alarm_id);
+
+      char const io_type[] = "G1 OUT";
+      CPPUNIT_ASSERT(!m_message_handler->handle_message(io_type, 5));
+
+      char const alarm[] = "C01 01Y 10-09 03:45 D1440";
+      CPPUNIT_ASSERT(m_message_handler->handle_message(alarm, 13));
+      TM expected_time; set_default_alarm_time(&expected_time);
+      expected_time.tm_mon = OCT;
+      expected_time.tm_mday = 9;
+      CPPUNIT_ASSERT_EQUAL(Alarm((INTERVAL)'Y', &expected_time, 1, 0), m_alarm);
+
+      char const unknown[] = "Z";
+      CPPUNIT_ASSERT(!m_message_handler->handle_message(unknown, 1));
+      assert_invalid_reply('Z');
+   }
+
+   void BatchMessageTest()
+   {
+      CPPUNIT_ASSERT(handle_frame("*C01 01Y;D02;F3"));
+      CPPUNIT_ASSERT_EQUAL(std::string(">* OK 0007"), m_reply);
+      CPPUNIT_ASSERT_EQUAL(3, callback_set_count());
+      CPPUNIT_ASSERT_EQUAL(2, m_alarm_id);
+      CPPUNIT_ASSERT_EQUAL(3, m_io_trigger);
+
+      // Failed commands do not stop the rest, and commands with their own reply are refused
+      CPPUNIT_ASSERT(!handle_frame("*D17;E4 1&2;B;;D05"));
+      CPPUNIT_ASSERT_EQUAL(std::string(">* FAIL 0012"), m_reply);
+      CPPUNIT_ASSERT_EQUAL(std::string("1&2"), m_trigger);
+      CPPUNIT_ASSERT_EQUAL(5, m_alarm_id);
+
+      CPPUNIT_ASSERT(!handle_frame("*F1;F1;F1;F1;F1;F1;F1;F1;F1;F1;F1;F1;F1;F1;F1;F1;F1"));
+      CPPUNIT_ASSERT_EQUAL(std::string(">* FAIL 0000"), m_reply);
+   }
+
+   void AllOrNothingBatchMessageTest()
+   {
+      CPPUNIT_ASSERT(!handle_frame("#D01;C01 51Y;F1"));
+      CPPUNIT_ASSERT_EQUAL(std::string("># FAIL 0005"), m_reply);
+      CPPUNIT_ASSERT_EQUAL(0, callback_set_count());
+
+      // Trigger expressions are parsed when checking, up to the separator only
+      CPPUNIT_ASSERT(!handle_frame("#D01;E1 1&(2;F1"));
+      CPPUNIT_ASSERT_EQUAL(std::string("># FAIL 0005"), m_reply);
+      CPPUNIT_ASSERT_EQUAL(0, callback_set_count());
+
+      CPPUNIT_ASSERT(handle_frame("#E1 1&!2;F1"));
+      CPPUNIT_ASSERT_EQUAL(std::string("># OK 0003"), m_reply);
+      CPPUNIT_ASSERT_EQUAL(std::string("1&!2"), m_trigger);
+      memset(m_callback_flags, false, MSG_MAX_ID);
+
+      CPPUNIT_ASSERT(handle_frame("#D01;C04 02Y;F1"));
+      CPPUNIT_ASSERT_EQUAL(std::string("># OK 0007"), m_reply);
+      CPPUNIT_ASSERT_EQUAL(3, callback_set_count());
+      CPPUNIT_ASSERT_EQUAL(4, m_alarm_id);
+      CPPUNIT_ASSERT_EQUAL(2, m_alarm.get_repeat());
+   }
 };
 
 
@@ -649,9 +732,9 @@ static bool clr_alarm_callback(int alarm_id)
    return s_test_object->Clr_alarm_callback(alarm_id);
 }
 
-static bool set_trigger_callback(int io_index, char * pTriggerExpression)
+static bool set_trigger_callback(int io_index, char const * pTriggerExpression, size_t length)
 {
-   return s_test_object->Set_trigger_callback(io_index, pTriggerExpression);
+   return s_test_object->Set_trigger_callback(io_index, pTriggerExpression, length);
 }
 
 static bool clear_trigger_callback(int io_index)
@@ -0,0 +1,183 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Utility/util_time.h"
+
+#include "alarm.h"
+#include "packed_alarm.h"
+
+static const TM s_alarm_datetime = {
+   0,
+   05,
+   20, // Hour
+   4, // Date
+   JUL, // Month
+   96, // Year
+   THU, //Weekday
+   185, // Day-of-year
+   0, // DST
+   0, // ignored by util_time
+   0 // ignored by util_time
+};
+
+static const INTERVAL s_intervals[] = {INTERVAL_HOUR, INTERVAL_DAY, INTERVAL_WEEK, INTERVAL_MONTH, INTERVAL_YEAR};
+
+static const UNIX_TIMESTAMP s_start_time = 836510400; // 4th July 1996 20:00:00
+
+class PackedAlarmTest : public CppUnit::TestFixture  {
+
+   CPPUNIT_TEST_SUITE(PackedAlarmTest);
+
+   CPPUNIT_TEST(PackedAlarmTestIsEightBytes);
+   CPPUNIT_TEST(PackedAlarmTestEmptyIsInvalid);
+   CPPUNIT_TEST(PackedAlarmTestRejectsUnrepresentableAlarms);
+   CPPUNIT_TEST(PackedAlarmTestTriggersAndExpires);
+   CPPUNIT_TEST(PackedAlarmTestStringRoundTrip);
+   CPPUNIT_TEST(PackedAlarmTestAlarmRoundTripKeepsState);
+   CPPUNIT_TEST(PackedAlarmTestMatchesAlarmForEveryInterval);
+
+   CPPUNIT_TEST_SUITE_END();
+
+protected:
+
+   void PackedAlarmTestIsEightBytes()
+   {
+      CPPUNIT_ASSERT_EQUAL((size_t)8, sizeof(PackedAlarm));
+   }
+
+   void PackedAlarmTestEmptyIsInvalid()
+   {
+      PackedAlarm alarm;
+      ALARM_STRING str;
+
+      CPPUNIT_ASSERT(!alarm.valid());
+      CPPUNIT_ASSERT(!alarm.set_current_time(&s_alarm_datetime));
+      CPPUNIT_ASSERT(!alarm.to_string(&str));
+   }
+
+   void PackedAlarmTestRejectsUnrepresentableAlarms()
+   {
+      PackedAlarm packed;
+
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, PACKED_ALARM_MAX_REPEAT + 1, 60);
+      CPPUNIT_ASSERT(!packed.from_alarm(&alarm));
+
+      alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, PACKED_ALARM_MAX_DURATION + 1);
+      CPPUNIT_ASSERT(!packed.from_alarm(&alarm));
+
+      alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 1, 60);
+      TM extra = s_alarm_datetime;
+      extra.tm_min = 35;
+      alarm.add_match(&extra);
+      CPPUNIT_ASSERT(!packed.from_alarm(&alarm));
+
+      CPPUNIT_ASSERT(!packed.valid());
+   }
+
+   void PackedAlarmTestTriggersAndExpires()
+   {
+      PackedAlarm alarm = PackedAlarm(INTERVAL_DAY, &s_alarm_datetime, 1, 30);
+      CPPUNIT_ASSERT(alarm.valid());
+
+      TM datetime = s_alarm_datetime;
+      CPPUNIT_ASSERT(alarm.set_current_time(&datetime));
+
+      datetime.tm_min += 30;
+      CPPUNIT_ASSERT(alarm.set_current_time(&datetime));
+
+      datetime.tm_min++;
+      CPPUNIT_ASSERT(!alarm.set_current_time(&datetime));
+   }
+
+   void PackedAlarmTestStringRoundTrip()
+   {
+      int i;
+      for (i = 0; i < 5; ++i)
+      {
+         Alarm alarm = Alarm(s_intervals[i], &s_alarm_datetime, 12, 1440);
+         PackedAlarm packed;
+         PackedAlarm parsed;
+         ALARM_STRING str;
+
+         CPPUNIT_ASSERT(packed.from_alarm(&alarm));
+         CPPUNIT_ASSERT(packed.to_string(&str));
+         CPPUNIT_ASSERT(parsed.from_string(&str));
+         CPPUNIT_ASSERT(packed == parsed);
+      }
+   }
+
+   void PackedAlarmTestAlarmRoundTripKeepsState()
+   {
+      Alarm alarm = Alarm(INTERVAL_HOUR, &s_alarm_datetime, 2, 10);
+      Alarm unpacked;
+      PackedAlarm packed;
+
+      // One match counted
+      CPPUNIT_ASSERT(!alarm.set_current_time(s_start_time + (5 * 60)));
+      CPPUNIT_ASSERT(packed.from_alarm(&alarm));
+      CPPUNIT_ASSERT(packed.to_alarm(&unpacked, s_start_time + (5 * 60)));
+      CPPUNIT_ASSERT(unpacked.set_current_time(s_start_time + (65 * 60)));
+
+      // Triggered, and expires at the same time as the original
+      CPPUNIT_ASSERT(alarm.set_current_time(s_start_time + (65 * 60)));
+      CPPUNIT_ASSERT(packed.from_alarm(&alarm));
+      CPPUNIT_ASSERT(packed.to_alarm(&unpacked, s_start_time + (70 * 60)));
+      CPPUNIT_ASSERT(unpacked.set_current_time(s_start_time + (75 * 60)));
+      CPPUNIT_ASSERT(!unpacked.set_current_time(s_start_time + (76 * 60)));
+   }
+
+   void PackedAlarmTestMatchesAlarmForEveryInterval()
+   {
+      Alarm alarms[20];
+      PackedAlarm packed[20];
+      UNIX_TIMESTAMP time;
+      int i;
+
+      srand(1);
+
+      for (i = 0; i < 20; ++i)
+      {
+         TM alarm_time = s_alarm_datetime;
+         alarm_time.tm_min = rand() % 60;
+         alarm_time.tm_hour = rand() % 24;
+         alarm_time.tm_mday = 1 + (rand() % 31);
+         alarm_time.tm_mon = JUL + (rand() % 2);
+         alarm_time.tm_wday = rand() % 7;
+         alarms[i] = Alarm(s_intervals[i % 5], &alarm_time, 1 + (rand() % 3), 1 + (rand() % 300));
+         CPPUNIT_ASSERT(packed[i].from_alarm(&alarms[i]));
+      }
+
+      // Every minute for two months
+      for (time = s_start_time; time < s_start_time + (62UL * 24 * 60 * 60); time += 60)
+      {
+         for (i = 0; i < 20; ++i)
+         {
+            CPPUNIT_ASSERT_EQUAL(alarms[i].set_current_time(time), packed[i].set_current_time(time));
+         }
+      }
+   }
+};
+
+int main()
+{
+   CppUnit::TextUi::TestRunner runner;
+
+   CPPUNIT_TEST_SUITE_REGISTRATION( PackedAlarmTest );
+
+   CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+
+   runner.addTest( registry.makeTest() );
+   runner.run();
+
+   return 0;
+}
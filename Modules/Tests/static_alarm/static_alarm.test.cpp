@@ -0,0 +1,146 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "Utility/util_time.h"
+
+#include "alarm.h"
+#include "static_alarm.h"
+
+static const TM s_alarm_datetime = {
+   0,
+   05,
+   20, // Hour
+   4, // Date
+   JUL, // Month
+   96, // Year
+   THU, //Weekday
+   185, // Day-of-year
+   0, // DST
+   0, // ignored by util_time
+   0 // ignored by util_time
+};
+
+// Configuration fixed at build time
+static constexpr StaticAlarm<INTERVAL_HOUR> s_hourly[] = {
+   StaticAlarm<INTERVAL_HOUR>(1, 10, 5),
+   StaticAlarm<INTERVAL_HOUR>(3, 0, 30)
+};
+
+static constexpr StaticAlarm<INTERVAL_DAY> s_daily[] = {
+   StaticAlarm<INTERVAL_DAY>(1, 90, 5, 20),
+   StaticAlarm<INTERVAL_DAY>(2, 1, 0, 0)
+};
+
+static constexpr StaticAlarm<INTERVAL_WEEK> s_weekly = StaticAlarm<INTERVAL_WEEK>(1, 30, 5, 20, THU);
+static constexpr StaticAlarm<INTERVAL_MONTH> s_monthly = StaticAlarm<INTERVAL_MONTH>(1, 600, 5, 20, 4);
+static constexpr StaticAlarm<INTERVAL_YEAR> s_yearly = StaticAlarm<INTERVAL_YEAR>(1, 60, 5, 20, 4, JUL);
+static constexpr StaticAlarm<INTERVAL_YEAR> s_long = StaticAlarm<INTERVAL_YEAR>(1, 100000, 5, 20, 4, JUL); // Over 65535 minutes
+
+// Matching is evaluated by the compiler
+static_assert(s_hourly[0].matches(5, 0, 1, JAN, SUN), "hourly alarm ignores hour and date");
+static_assert(!s_daily[0].matches(5, 21, 4, JUL, THU), "daily alarm compares hour");
+static_assert(!s_weekly.matches(5, 20, 4, JUL, FRI), "weekly alarm compares weekday");
+static_assert(s_monthly.matches(5, 20, 4, DEC, MON), "monthly alarm ignores month and weekday");
+static_assert(!s_yearly.matches(5, 20, 4, JUN, THU), "yearly alarm compares month");
+
+// Fields at the edges of their ranges compile; one past them (e.g. minute 60) does not
+static constexpr StaticAlarm<INTERVAL_WEEK> s_week_limits[] = {
+   StaticAlarm<INTERVAL_WEEK>(1, 0, 0, 0, SUN),
+   StaticAlarm<INTERVAL_WEEK>(255, 0, 59, 23, SAT)
+};
+static constexpr StaticAlarm<INTERVAL_YEAR> s_year_limits[] = {
+   StaticAlarm<INTERVAL_YEAR>(1, 0, 0, 0, 1, JAN),
+   StaticAlarm<INTERVAL_YEAR>(1, 0, 59, 23, 31, DEC)
+};
+static_assert(s_week_limits[1].matches(59, 23, 1, JAN, SAT), "weekly alarm accepts the last minute of the week");
+static_assert(s_year_limits[1].matches(59, 23, 31, DEC, SUN), "yearly alarm accepts the last minute of the year");
+
+class StaticAlarmTest : public CppUnit::TestFixture  {
+
+   CPPUNIT_TEST_SUITE(StaticAlarmTest);
+
+   CPPUNIT_TEST(StaticAlarmTestTriggersAndExpires);
+   CPPUNIT_TEST(StaticAlarmTestConvertsToAlarm);
+   CPPUNIT_TEST(StaticAlarmTestMatchesAlarm);
+
+   CPPUNIT_TEST_SUITE_END();
+
+protected:
+
+   void StaticAlarmTestTriggersAndExpires()
+   {
+      STATIC_ALARM_STATE state = {0, 0, false};
+      TM datetime = s_alarm_datetime;
+
+      CPPUNIT_ASSERT(s_weekly.set_current_time(&state, &datetime));
+
+      datetime.tm_min += 30;
+      CPPUNIT_ASSERT(s_weekly.set_current_time(&state, &datetime));
+
+      datetime.tm_min++;
+      CPPUNIT_ASSERT(!s_weekly.set_current_time(&state, &datetime));
+   }
+
+   void StaticAlarmTestConvertsToAlarm()
+   {
+      TM alarm_time;
+      set_default_alarm_time(&alarm_time);
+      alarm_time.tm_min = 5;
+      alarm_time.tm_hour = 20;
+      alarm_time.tm_wday = THU;
+
+      CPPUNIT_ASSERT_EQUAL(Alarm(INTERVAL_WEEK, &alarm_time, 1, 30), s_weekly.to_alarm());
+   }
+
+   template<INTERVAL I>
+   void check_matches_alarm(StaticAlarm<I> const& static_alarm)
+   {
+      Alarm alarm = static_alarm.to_alarm();
+      STATIC_ALARM_STATE state = {0, 0, false};
+      UNIX_TIMESTAMP time;
+      TM datetime;
+
+      // Every minute for two years from 1st January 1996
+      for (time = 820454400; time < 820454400 + (731UL * 24 * 60 * 60); time += 60)
+      {
+         seconds_to_alarm_time(time, &datetime);
+         CPPUNIT_ASSERT_EQUAL(alarm.set_current_time(&datetime), static_alarm.set_current_time(&state, &datetime));
+      }
+   }
+
+   void StaticAlarmTestMatchesAlarm()
+   {
+      check_matches_alarm(s_hourly[0]);
+      check_matches_alarm(s_hourly[1]);
+      check_matches_alarm(s_daily[0]);
+      check_matches_alarm(s_daily[1]);
+      check_matches_alarm(s_weekly);
+      check_matches_alarm(s_monthly);
+      check_matches_alarm(s_yearly);
+      check_matches_alarm(s_long);
+   }
+};
+
+int main()
+{
+   CppUnit::TextUi::TestRunner runner;
+
+   CPPUNIT_TEST_SUITE_REGISTRATION( StaticAlarmTest );
+
+   CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+
+   runner.addTest( registry.makeTest() );
+   runner.run();
+
+   return 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "ast_node.h"
+#include "syntax_parser.h"
+#include "app.config.h"
+#include "static_expression.h"
+
+#define TEST_FUNCTIONS (4)
+
+static bool s_inputs[TEST_FUNCTIONS];
+
+template <int FID> static bool fInput(void) { return s_inputs[FID]; }
+
+// Compiled at build time
+static constexpr LEPProgram s_call = LEP_StaticCompile("19");
+static constexpr LEPProgram s_and = LEP_StaticCompile("0 & !1");
+
+static_assert(s_call.Length == 2, "A call is an opcode and a function ID");
+static_assert((s_call.Code[0] == LEP_OP_CALL) && (s_call.Code[1] == 19), "Calls function 19");
+
+static_assert(s_and.Length == 7, "CALL 0, JUMP_IF_FALSE, CALL 1, NOT");
+static_assert(s_and.Code[2] == LEP_OP_JUMP_IF_FALSE, "AND short-circuits on false");
+static_assert(s_and.Code[3] == 3, "The jump skips to the end");
+static_assert(s_and.Code[6] == LEP_OP_NOT, "NOT follows its operand");
+
+// Each of these would stop the build:
+//    LEP_StaticCompile("1 || 2"), LEP_StaticCompile("(1&2"), LEP_StaticCompile("20")
+
+static char const * const s_expressions[] = {
+   "0", "T", "!F", "0&1", "0|1", "0&1|2", "!(0&1)|2", "(0|!1)&(2|3)&!(0&3)", " 1 & ( 2 | !0 ) ",
+   "!!3", "0|1|2|3", "0&1&2&3", "((0))"
+};
+
+static constexpr LEPProgram s_programs[] = {
+   LEP_StaticCompile("0"), LEP_StaticCompile("T"), LEP_StaticCompile("!F"), LEP_StaticCompile("0&1"),
+   LEP_StaticCompile("0|1"), LEP_StaticCompile("0&1|2"), LEP_StaticCompile("!(0&1)|2"),
+   LEP_StaticCompile("(0|!1)&(2|3)&!(0&3)"), LEP_StaticCompile(" 1 & ( 2 | !0 ) "),
+   LEP_StaticCompile("!!3"), LEP_StaticCompile("0|1|2|3"), LEP_StaticCompile("0&1&2&3"), LEP_StaticCompile("((0))")
+};
+
+class StaticExpressionTest : public CppUnit::TestFixture  {
+
+   CPPUNIT_TEST_SUITE(StaticExpressionTest);
+
+   CPPUNIT_TEST(StaticProgramsMatchParsedExpressions);
+
+   CPPUNIT_TEST_SUITE_END();
+
+protected:
+
+   void StaticProgramsMatchParsedExpressions()
+   {
+      Parser parser;
+      size_t i;
+      int combination;
+      int fid;
+
+      for (i = 0; i < sizeof(s_expressions) / sizeof(s_expressions[0]); ++i)
+      {
+         ASTNode * pNode = LEP_Parse(&parser, s_expressions[i], NULL);
+         CPPUNIT_ASSERT_MESSAGE(s_expressions[i], parser.m_success);
+
+         for (combination = 0; combination < (1 << TEST_FUNCTIONS); ++combination)
+         {
+            for (fid = 0; fid < TEST_FUNCTIONS; ++fid) { s_inputs[fid] = (combination >> fid) & 1; }
+            CPPUNIT_ASSERT_EQUAL_MESSAGE(s_expressions[i], LEP_Evaluate(pNode), LEP_Run(&s_programs[i]));
+         }
+      }
+   }
+};
+
+int main()
+{
+   LEP_Init();
+
+   LEP_RegisterFunction(0, fInput<0>);
+   LEP_RegisterFunction(1, fInput<1>);
+   LEP_RegisterFunction(2, fInput<2>);
+   LEP_RegisterFunction(3, fInput<3>);
+
+   CppUnit::TextUi::TestRunner runner;
+
+   CPPUNIT_TEST_SUITE_REGISTRATION( StaticExpressionTest );
+
+   CppUnit::TestFactoryRegistry &registry = CppUnit::TestFactoryRegistry::getRegistry();
+
+   runner.addTest( registry.makeTest() );
+   runner.run();
+
+   return 0;
+}
@@ -4,7 +4,9 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <iostream>
+#include <string>
 
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/ui/text/TestRunner.h>
@@ -12,6 +14,10 @@
 
 #include "ast_node.h"
 #include "syntax_parser.h"
+#include "app.config.h"
+
+#define MAX_TEST_NODES (64)
+#define BATCH_TEST_FUNCTIONS (6)
 
 static char const * s_pToTest = NULL;
 bool s_expected = false;
@@ -19,6 +25,16 @@ bool s_expected = false;
 static bool fTrue(void) { return true; }
 static bool fFalse(void) { return false; }
 
+// Function 4 is slow and always true; function 5 is cheap and always false
+static uint32_t s_clock_ticks = 0;
+static int s_slow_calls = 0;
+static uint32_t testClock(void) { return s_clock_ticks; }
+static bool fSlowTrue(void) { s_clock_ticks += 100; s_slow_calls++; return true; }
+
+// Function 6 returns s_switch
+static bool s_switch = true;
+static bool fSwitch(void) { return s_switch; }
+
 #define RUN_SUCCESS_TEST(arg, expected) \
    s_pToTest = arg; \
    s_expected = expected; \
@@ -33,22 +49,83 @@ class SyntaxParserTest : public CppUnit::TestFixture  {
    CPPUNIT_TEST_SUITE(SyntaxParserTest);
    CPPUNIT_TEST(ValidSyntaxTests);
    CPPUNIT_TEST(InvalidSyntaxTests);
+   CPPUNIT_TEST(FunctionIDTests);
+   CPPUNIT_TEST(CompileTooLongTest);
+   CPPUNIT_TEST(ArenasCoexistTest);
+   CPPUNIT_TEST(ArenaTooSmallTest);
+   CPPUNIT_TEST(OptimiseNodeCountTests);
+   CPPUNIT_TEST(ShortCircuitTest);
+   CPPUNIT_TEST(AdaptiveReorderTest);
+   CPPUNIT_TEST(ReorderLongChainTest);
+   CPPUNIT_TEST(TruthTableTest);
+   CPPUNIT_TEST(PrepareFallbackTest);
+   CPPUNIT_TEST(BatchMatchesTableTest);
+   CPPUNIT_TEST(SharedSubexpressionsAreStoredOnce);
+   CPPUNIT_TEST(SharedNodesAreEvaluatedOncePerTick);
+   CPPUNIT_TEST(ErrorCodesAndPositions);
+   CPPUNIT_TEST(DepthLimitTest);
+   CPPUNIT_TEST(EvaluationDepthLimitTest);
+   CPPUNIT_TEST(CompactNodeTest);
    CPPUNIT_TEST_SUITE_END();
 
    void TestForParseSuccess(void)
    {
       Parser parser;
-      ASTNode * pNode = LEP_Parse(&parser, s_pToTest);
-      CPPUNIT_ASSERT_MESSAGE(parser.m_errorMessage, parser.m_success);
+      ASTNode nodes[MAX_TEST_NODES];
+      ASTArena arena;
+      AST_InitArena(&arena, nodes, MAX_TEST_NODES);
+
+      ASTNode * pNode = LEP_Parse(&parser, s_pToTest, &arena);
+      CPPUNIT_ASSERT_MESSAGE(LEP_GetErrorMessage(&parser), parser.m_success);
+      CPPUNIT_ASSERT_EQUAL(AST_CountNodes(pNode), arena.Count);
 
       bool actual = LEP_Evaluate(pNode);
       CPPUNIT_ASSERT_EQUAL(s_expected, actual);
+
+      LEPProgram program;
+      CPPUNIT_ASSERT(LEP_Compile(pNode, &program));
+      CPPUNIT_ASSERT_EQUAL(s_expected, LEP_Run(&program));
+
+      // Optimised, from a tree left in the shared pool
+      ASTNode optimised_nodes[MAX_TEST_NODES];
+      ASTArena optimised;
+      AST_InitArena(&optimised, optimised_nodes, MAX_TEST_NODES);
+
+      pNode = LEP_Optimise(&parser, LEP_Parse(&parser, s_pToTest, NULL), &optimised);
+      CPPUNIT_ASSERT_MESSAGE(LEP_GetErrorMessage(&parser), parser.m_success);
+      CPPUNIT_ASSERT_EQUAL(AST_CountNodes(pNode), optimised.Count);
+      CPPUNIT_ASSERT_EQUAL(s_expected, LEP_Evaluate(pNode));
+      CPPUNIT_ASSERT(LEP_Compile(pNode, &program));
+      CPPUNIT_ASSERT_EQUAL(s_expected, LEP_Run(&program));
+
+      CompactNode compact_nodes[MAX_TEST_NODES];
+      CompactArena compact;
+      AST_InitCompactArena(&compact, compact_nodes, MAX_TEST_NODES);
+      uint16_t root = LEP_ParseCompact(&parser, s_pToTest, &compact);
+      CPPUNIT_ASSERT_MESSAGE(LEP_GetErrorMessage(&parser), parser.m_success);
+      CPPUNIT_ASSERT_EQUAL(s_expected, LEP_EvaluateCompact(&compact, root));
+
+      LEPExpression expression;
+      CPPUNIT_ASSERT_EQUAL(LEP_MODE_TABLE, LEP_Prepare(pNode, &expression));
+      CPPUNIT_ASSERT_EQUAL(s_expected, LEP_EvaluateExpression(&expression));
+      CPPUNIT_ASSERT_EQUAL(s_expected, LEP_RunTable(&expression.Table, LEP_ReadInputs()));
+   }
+
+   uint8_t optimised_size(char const * text)
+   {
+      Parser parser;
+      ASTNode nodes[MAX_TEST_NODES];
+      ASTArena arena;
+      AST_InitArena(&arena, nodes, MAX_TEST_NODES);
+
+      CPPUNIT_ASSERT(LEP_Optimise(&parser, LEP_Parse(&parser, text, NULL), &arena));
+      return arena.Count;
    }
 
    void TestForParseFailure(void)
    {
       Parser parser;
-      ASTNode * pNode = LEP_Parse(&parser, s_pToTest);
+      ASTNode * pNode = LEP_Parse(&parser, s_pToTest, NULL);
       CPPUNIT_ASSERT(!pNode);
       CPPUNIT_ASSERT(!parser.m_success);
    }
@@ -135,6 +212,453 @@ class SyntaxParserTest : public CppUnit::TestFixture  {
       RUN_FAILURE_TEST("1 || 2.5");
       RUN_FAILURE_TEST("|1 & 2.5");
    }
+
+   void FunctionIDTests()
+   {
+      // Function 2 is true and 3 is false
+      RUN_SUCCESS_TEST("2", true);
+      RUN_SUCCESS_TEST("3", false);
+      RUN_SUCCESS_TEST("2&!3", true);
+      RUN_SUCCESS_TEST("(3|0)|(2&3)", false);
+   }
+
+   void CompileTooLongTest()
+   {
+      Parser parser;
+      LEPProgram program;
+      ASTNode * pNode = LEP_Parse(&parser, "1&1&1&1&1&1&1&1&1&1&1&1&1&1&1&1&1&1&1&1", NULL);
+      CPPUNIT_ASSERT(parser.m_success);
+      CPPUNIT_ASSERT(!LEP_Compile(pNode, &program));
+      CPPUNIT_ASSERT(!LEP_Run(&program));
+   }
+
+   void ArenasCoexistTest()
+   {
+      Parser parser;
+      ASTNode nodes_a[MAX_TEST_NODES];
+      ASTNode nodes_b[MAX_TEST_NODES];
+      ASTArena arena_a;
+      ASTArena arena_b;
+      AST_InitArena(&arena_a, nodes_a, MAX_TEST_NODES);
+      AST_InitArena(&arena_b, nodes_b, MAX_TEST_NODES);
+
+      ASTNode * a = LEP_Parse(&parser, "1&(0|2)", &arena_a);
+      ASTNode * b = LEP_Parse(&parser, "!(1|3)", &arena_b);
+
+      CPPUNIT_ASSERT(a == &nodes_a[0]);
+      CPPUNIT_ASSERT(b == &nodes_b[0]);
+      CPPUNIT_ASSERT(LEP_Evaluate(a));
+      CPPUNIT_ASSERT(!LEP_Evaluate(b));
+   }
+
+   void ArenaTooSmallTest()
+   {
+      Parser parser;
+      ASTNode nodes[4];
+      ASTArena arena;
+      AST_InitArena(&arena, nodes, 4);
+
+      CPPUNIT_ASSERT(!LEP_Parse(&parser, "1&(0|2)", &arena));
+      CPPUNIT_ASSERT(!parser.m_success);
+
+      // The arena reports the exact size needed
+      ASTNode exact_nodes[MAX_TEST_NODES];
+      uint8_t needed = arena.Count;
+      AST_InitArena(&arena, exact_nodes, needed);
+      CPPUNIT_ASSERT(LEP_Parse(&parser, "1&(0|2)", &arena));
+      CPPUNIT_ASSERT_EQUAL(needed, arena.Count);
+   }
+
+   void OptimiseNodeCountTests()
+   {
+      CPPUNIT_ASSERT_EQUAL((uint8_t)1, optimised_size("1"));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)1, optimised_size("!!1"));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)1, optimised_size("2|T"));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)1, optimised_size("!(2&F)"));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)2, optimised_size("!(2&T)"));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)4, optimised_size("1&2&3"));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)4, optimised_size("(1&2)&(3)"));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)5, optimised_size("(1|2)&3"));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)5, optimised_size("0|1|2|3"));
+   }
+
+   int slow_calls(char const * text, bool expected)
+   {
+      Parser parser;
+      LEPProgram program;
+      ASTNode * pNode = LEP_Parse(&parser, text, NULL);
+      CPPUNIT_ASSERT(parser.m_success);
+      CPPUNIT_ASSERT(LEP_Compile(pNode, &program));
+
+      s_slow_calls = 0;
+      CPPUNIT_ASSERT_EQUAL(expected, LEP_Evaluate(pNode));
+      CPPUNIT_ASSERT_EQUAL(expected, LEP_Run(&program));
+      return s_slow_calls;
+   }
+
+   void ShortCircuitTest()
+   {
+      CPPUNIT_ASSERT_EQUAL(0, slow_calls("0&4", false));
+      CPPUNIT_ASSERT_EQUAL(0, slow_calls("1|4", true));
+      CPPUNIT_ASSERT_EQUAL(0, slow_calls("(0&4)|(2|4)", true));
+      CPPUNIT_ASSERT_EQUAL(2, slow_calls("4&5", false));
+      CPPUNIT_ASSERT_EQUAL(2, slow_calls("0|!4", false));
+   }
+
+   void AdaptiveReorderTest()
+   {
+      Parser parser;
+      LEPProgram program;
+      ASTNode nodes[MAX_TEST_NODES];
+      ASTArena arena;
+      int i;
+
+      AST_InitArena(&arena, nodes, MAX_TEST_NODES);
+      ASTNode * binary = LEP_Parse(&parser, "4&5", &arena);
+      ASTNode optimised_nodes[MAX_TEST_NODES];
+      ASTArena optimised;
+      AST_InitArena(&optimised, optimised_nodes, MAX_TEST_NODES);
+      ASTNode * nary = LEP_Optimise(&parser, LEP_Parse(&parser, "1&4&5", NULL), &optimised);
+      CPPUNIT_ASSERT(parser.m_success);
+
+      LEP_SetAdaptive(true, testClock);
+
+      s_slow_calls = 0;
+      for (i = 0; i < 10; ++i) { CPPUNIT_ASSERT(!LEP_Evaluate(binary)); }
+      CPPUNIT_ASSERT_EQUAL(10, s_slow_calls);
+
+      // The cheap, always false operand now goes first in both forms
+      CPPUNIT_ASSERT(LEP_Reorder(binary));
+      CPPUNIT_ASSERT(LEP_Reorder(nary));
+      CPPUNIT_ASSERT(LEP_Compile(binary, &program));
+
+      // Shared nodes belong to every expression using them, so are left alone
+      AST_ClearShared();
+      ASTNode * shared = LEP_ParseShared(&parser, "4&5");
+      CPPUNIT_ASSERT(shared);
+      CPPUNIT_ASSERT(!LEP_Reorder(shared));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)4, shared->Left->Value);
+      AST_ClearShared();
+
+      s_slow_calls = 0;
+      for (i = 0; i < 10; ++i)
+      {
+         CPPUNIT_ASSERT(!LEP_Evaluate(binary));
+         CPPUNIT_ASSERT(!LEP_Evaluate(nary));
+         CPPUNIT_ASSERT(!LEP_Run(&program));
+      }
+      CPPUNIT_ASSERT_EQUAL(0, s_slow_calls);
+
+      LEP_SetAdaptive(false, NULL);
+   }
+
+   void ReorderLongChainTest()
+   {
+      Parser parser;
+      ASTNode nodes[(2 * 41) - 1];
+      ASTArena arena;
+      std::string text;
+      ASTNode * link;
+      int links = 0;
+      int i;
+
+      text = "";
+      for (i = 0; i < 40; ++i) { text += "1&"; }
+      text += "6";
+
+      AST_InitArena(&arena, nodes, sizeof(nodes) / sizeof(nodes[0]));
+      ASTNode * chain = LEP_Parse(&parser, text.c_str(), &arena);
+      CPPUNIT_ASSERT_MESSAGE(LEP_GetErrorMessage(&parser), parser.m_success);
+
+      s_switch = true;
+      CPPUNIT_ASSERT(LEP_Evaluate(chain));
+
+      // Function 6 is now the one that decides the AND, so should go first
+      LEP_SetAdaptive(true, NULL);
+      s_switch = false;
+      for (i = 0; i < 20; ++i) { CPPUNIT_ASSERT(!LEP_Evaluate(chain)); }
+      CPPUNIT_ASSERT(LEP_Reorder(chain));
+      LEP_SetAdaptive(false, NULL);
+
+      CPPUNIT_ASSERT_EQUAL((uint8_t)6, chain->Left->Value);
+      CPPUNIT_ASSERT(!LEP_Evaluate(chain));
+      s_switch = true;
+      CPPUNIT_ASSERT(LEP_Evaluate(chain));
+
+      // Still one right-leaning chain
+      for (link = chain; link->Type == OperatorAnd; link = link->Right)
+      {
+         CPPUNIT_ASSERT_EQUAL(FunctionID, link->Left->Type);
+         links++;
+      }
+      CPPUNIT_ASSERT_EQUAL(40, links);
+   }
+
+   void TruthTableTest()
+   {
+      Parser parser;
+      LEPTable table;
+      LEPINPUTS inputs;
+
+      ASTNode * pNode = LEP_Parse(&parser, "(6&7)|!8", NULL);
+      CPPUNIT_ASSERT(LEP_CompileTable(pNode, &table));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)3, table.InputCount);
+      CPPUNIT_ASSERT(!table.Direct);
+
+      for (inputs = 0; inputs < 8; ++inputs)
+      {
+         bool f6 = inputs & 1, f7 = inputs & 2, f8 = inputs & 4;
+         CPPUNIT_ASSERT_EQUAL((f6 && f7) || !f8, LEP_RunTable(&table, inputs << 6));
+      }
+
+      // Functions 0 to n-1 index the table directly
+      pNode = LEP_Parse(&parser, "0|(1&!2)", NULL);
+      CPPUNIT_ASSERT(LEP_CompileTable(pNode, &table));
+      CPPUNIT_ASSERT(table.Direct);
+      CPPUNIT_ASSERT(LEP_RunTable(&table, 0x02));
+      CPPUNIT_ASSERT(!LEP_RunTable(&table, 0x06));
+   }
+
+   void PrepareFallbackTest()
+   {
+      Parser parser;
+      LEPExpression expression;
+
+      // Thirteen distinct functions are too many for a table
+      ASTNode * pNode = LEP_Parse(&parser, "0|1|2|3|6|7|8|9|10|11|12|13|14", NULL);
+      CPPUNIT_ASSERT(parser.m_success);
+      CPPUNIT_ASSERT(!LEP_CompileTable(pNode, &expression.Table));
+      CPPUNIT_ASSERT_EQUAL(LEP_MODE_PROGRAM, LEP_Prepare(pNode, &expression));
+      CPPUNIT_ASSERT(LEP_EvaluateExpression(&expression));
+
+      // ...and this is too long to compile
+      pNode = LEP_Parse(&parser, "0|1|2|3|6|7|8|9|10|11|12|13|14|15|16|17|18|19|1|1|1|1|1|1", NULL);
+      CPPUNIT_ASSERT(parser.m_success);
+      CPPUNIT_ASSERT_EQUAL(LEP_MODE_TREE, LEP_Prepare(pNode, &expression));
+      CPPUNIT_ASSERT(LEP_EvaluateExpression(&expression));
+   }
+
+   void SharedSubexpressionsAreStoredOnce()
+   {
+      Parser parser;
+      AST_ClearShared();
+
+      ASTNode * a = LEP_ParseShared(&parser, "(1|2)&!5");
+      CPPUNIT_ASSERT(parser.m_success);
+      uint8_t count = AST_SharedCount();
+
+      // The same expression, however it is spaced, adds nothing
+      CPPUNIT_ASSERT(a == LEP_ParseShared(&parser, " ( 1 | 2 ) & ! 5 "));
+      CPPUNIT_ASSERT_EQUAL(count, AST_SharedCount());
+
+      // Reusing it as a subexpression adds only the new leaf and operator
+      ASTNode * b = LEP_ParseShared(&parser, "3&((1|2)&!5)");
+      CPPUNIT_ASSERT(parser.m_success);
+      CPPUNIT_ASSERT((b->Left == a) || (b->Right == a));
+      CPPUNIT_ASSERT_EQUAL((uint8_t)(count + 2), AST_SharedCount());
+      CPPUNIT_ASSERT(LEP_EvaluateShared(b) == LEP_Evaluate(b));
+   }
+
+   void SharedNodesAreEvaluatedOncePerTick()
+   {
+      Parser parser;
+      AST_ClearShared();
+
+      ASTNode * a = LEP_ParseShared(&parser, "(4|3)&!5");
+      ASTNode * b = LEP_ParseShared(&parser, "1&((4|3)&!5)");
+      ASTNode * c = LEP_ParseShared(&parser, "!(4|3)|2");
+      CPPUNIT_ASSERT(parser.m_success);
+
+      AST_NextTick();
+      s_slow_calls = 0;
+      CPPUNIT_ASSERT(LEP_EvaluateShared(a));
+      CPPUNIT_ASSERT(LEP_EvaluateShared(b));
+      CPPUNIT_ASSERT(LEP_EvaluateShared(c));
+      CPPUNIT_ASSERT_EQUAL(1, s_slow_calls);
+
+      AST_NextTick();
+      CPPUNIT_ASSERT(LEP_EvaluateShared(b));
+      CPPUNIT_ASSERT_EQUAL(2, s_slow_calls);
+   }
+
+   void expect_error(char const * text, LEPError error, size_t position, uint16_t value, char const * message)
+   {
+      Parser parser;
+      CPPUNIT_ASSERT(!LEP_Parse(&parser, text, NULL));
+      CPPUNIT_ASSERT(!parser.m_success);
+      CPPUNIT_ASSERT_EQUAL(error, parser.m_error);
+      CPPUNIT_ASSERT_EQUAL(position, parser.m_errorPosition);
+      CPPUNIT_ASSERT_EQUAL(value, parser.m_errorValue);
+      CPPUNIT_ASSERT_EQUAL(std::string(message), std::string(LEP_GetErrorMessage(&parser)));
+   }
+
+   void ErrorCodesAndPositions()
+   {
+      expect_error("1 & 2,5", LEP_ERROR_UNEXPECTED_CHARACTER, 5, ',', "Bad character ',' at 5");
+      expect_error("1 |", LEP_ERROR_UNEXPECTED_TOKEN, 3, 0, "Unexpected end at 3");
+      expect_error("1 & | 2", LEP_ERROR_UNEXPECTED_TOKEN, 4, '|', "Unexpected '|' at 4");
+      expect_error("(1 & 2", LEP_ERROR_EXPECTED, 6, ')', "Expected ')' at 6");
+      expect_error("1 & 3000", LEP_ERROR_ID_TOO_LARGE, 4, 300, "ID 300 exceeds 255 at 4");
+      expect_error("  20", LEP_ERROR_ID_OUT_OF_RANGE, 2, 20, "ID 20 not below 20 at 2");
+
+      // Nothing is formatted for a successful parse
+      Parser parser;
+      CPPUNIT_ASSERT(LEP_Parse(&parser, "1", NULL));
+      CPPUNIT_ASSERT_EQUAL(LEP_ERROR_NONE, parser.m_error);
+      CPPUNIT_ASSERT_EQUAL(std::string(""), std::string(LEP_GetErrorMessage(&parser)));
+   }
+
+   void DepthLimitTest()
+   {
+      Parser parser;
+      std::string text;
+      int i;
+
+      // Long chains are not nesting
+      text = "1";
+      for (i = 0; i < 60; ++i) { text += (i % 2) ? "|0" : "&1"; }
+      text += "|1";
+      ASTNode * pNode = LEP_Parse(&parser, text.c_str(), NULL);
+      CPPUNIT_ASSERT_MESSAGE(LEP_GetErrorMessage(&parser), parser.m_success);
+      CPPUNIT_ASSERT(LEP_Evaluate(pNode));
+
+      // Nesting up to the limit is fine...
+      text = std::string(LEP_MAX_DEPTH - 1, '(') + "!1" + std::string(LEP_MAX_DEPTH - 1, ')');
+      pNode = LEP_Parse(&parser, text.c_str(), NULL);
+      CPPUNIT_ASSERT_MESSAGE(LEP_GetErrorMessage(&parser), parser.m_success);
+      CPPUNIT_ASSERT(!LEP_Evaluate(pNode));
+      CPPUNIT_ASSERT(!LEP_EvaluationTooDeep());
+
+      text = "1&(0|(!1&(1|(0&!(1))))|T)";
+      pNode = LEP_Parse(&parser, text.c_str(), NULL);
+      CPPUNIT_ASSERT(LEP_Evaluate(pNode));
+
+      // ...but one more is reported where it happens
+      text = std::string(LEP_MAX_DEPTH, '(') + "!1" + std::string(LEP_MAX_DEPTH, ')');
+      CPPUNIT_ASSERT(!LEP_Parse(&parser, text.c_str(), NULL));
+      CPPUNIT_ASSERT_EQUAL(LEP_ERROR_TOO_DEEP, parser.m_error);
+      CPPUNIT_ASSERT_EQUAL((size_t)LEP_MAX_DEPTH, parser.m_errorPosition);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)LEP_MAX_DEPTH, parser.m_errorValue);
+   }
+
+   void EvaluationDepthLimitTest()
+   {
+      ASTNode nodes[LEP_EVALUATION_DEPTH + 2];
+      CompactNode compact[LEP_EVALUATION_DEPTH + 2];
+      CompactArena arena;
+      int i;
+
+      // A chain of NOTs over a true leaf, root first
+      for (i = 0; i <= LEP_EVALUATION_DEPTH; ++i)
+      {
+         nodes[i].Type = UnaryNot;
+         nodes[i].Left = &nodes[i + 1];
+         nodes[i].Right = NULL;
+         compact[i].Type = UnaryNot;
+         compact[i].Left = i + 1;
+      }
+      nodes[i].Type = BoolValue;
+      nodes[i].Value = 1;
+      compact[i].Type = BoolValue;
+      compact[i].Value = 1;
+      AST_InitCompactArena(&arena, compact, LEP_EVALUATION_DEPTH + 2);
+      arena.Count = LEP_EVALUATION_DEPTH + 2;
+
+      // An even number of NOTs filling the stack exactly is evaluated...
+      CPPUNIT_ASSERT(LEP_Evaluate(&nodes[1]));
+      CPPUNIT_ASSERT(!LEP_EvaluationTooDeep());
+      CPPUNIT_ASSERT(LEP_EvaluateCompact(&arena, 1));
+      CPPUNIT_ASSERT(!LEP_EvaluationTooDeep());
+
+      // ...but one more is reported rather than read as false
+      CPPUNIT_ASSERT(!LEP_Evaluate(&nodes[0]));
+      CPPUNIT_ASSERT(LEP_EvaluationTooDeep());
+      CPPUNIT_ASSERT(!LEP_EvaluateCompact(&arena, 0));
+      CPPUNIT_ASSERT(LEP_EvaluationTooDeep());
+
+      // and cleared by the next evaluation
+      CPPUNIT_ASSERT(!LEP_Evaluate(&nodes[2]));
+      CPPUNIT_ASSERT(!LEP_EvaluationTooDeep());
+   }
+
+   void CompactNodeTest()
+   {
+      Parser parser;
+      CompactNode nodes[6];
+      CompactArena arena;
+
+      CPPUNIT_ASSERT_EQUAL((size_t)4, sizeof(CompactNode));
+
+      // Exactly one node per leaf and operator
+      AST_InitCompactArena(&arena, nodes, 6);
+      uint16_t root = LEP_ParseCompact(&parser, "1&!(0|3)", &arena);
+      CPPUNIT_ASSERT_MESSAGE(LEP_GetErrorMessage(&parser), parser.m_success);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)6, arena.Count);
+      CPPUNIT_ASSERT(LEP_EvaluateCompact(&arena, root));
+
+      CPPUNIT_ASSERT_EQUAL((uint16_t)LEP_NO_NODE, LEP_ParseCompact(&parser, "1&!(0|3)|2", &arena));
+      CPPUNIT_ASSERT_EQUAL(LEP_ERROR_NODE_POOL_FULL, parser.m_error);
+
+      // Short-circuits like LEP_Evaluate
+      AST_InitCompactArena(&arena, nodes, 6);
+      root = LEP_ParseCompact(&parser, "0&4", &arena);
+      s_slow_calls = 0;
+      CPPUNIT_ASSERT(!LEP_EvaluateCompact(&arena, root));
+      CPPUNIT_ASSERT_EQUAL(0, s_slow_calls);
+   }
+
+   void BatchMatchesTableTest()
+   {
+      static char const * const expressions[] = {"(0&!1)|(2&3)&!(4|5)", "!(0|1|T)|2&3&4", "5"};
+      Parser parser;
+      LEPTable table;
+      LEPBatch256 inputs[NUMBER_OF_IO+NUMBER_OF_ALARMS] = {};
+      uint64_t words[NUMBER_OF_IO+NUMBER_OF_ALARMS] = {0};
+      int i;
+      int step;
+
+      srand(1);
+
+      for (i = 0; i < BATCH_TEST_FUNCTIONS; ++i)
+      {
+         for (step = 0; step < 4; ++step)
+         {
+            inputs[i].Words[step] = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ rand();
+         }
+         words[i] = inputs[i].Words[0];
+      }
+
+      for (i = 0; i < 3; ++i)
+      {
+         ASTNode nodes[MAX_TEST_NODES];
+         ASTArena arena;
+         AST_InitArena(&arena, nodes, MAX_TEST_NODES);
+         ASTNode * pNode = LEP_Parse(&parser, expressions[i], &arena);
+         ASTNode optimised_nodes[MAX_TEST_NODES];
+         ASTArena optimised;
+         AST_InitArena(&optimised, optimised_nodes, MAX_TEST_NODES);
+         ASTNode * pOptimised = LEP_Optimise(&parser, LEP_Parse(&parser, expressions[i], NULL), &optimised);
+         CPPUNIT_ASSERT(parser.m_success);
+         CPPUNIT_ASSERT(LEP_CompileTable(pNode, &table));
+
+         uint64_t result = LEP_EvaluateBatch(pNode, words);
+         LEPBatch256 result256 = LEP_EvaluateBatch256(pOptimised, inputs);
+
+         for (step = 0; step < 256; ++step)
+         {
+            LEPINPUTS snapshot = 0;
+            int fid;
+            for (fid = 0; fid < BATCH_TEST_FUNCTIONS; ++fid)
+            {
+               snapshot |= ((inputs[fid].Words[step / 64] >> (step % 64)) & 1) << fid;
+            }
+
+            bool expected = LEP_RunTable(&table, snapshot);
+            CPPUNIT_ASSERT_EQUAL(expected, (bool)((result256.Words[step / 64] >> (step % 64)) & 1));
+            if (step < 64) { CPPUNIT_ASSERT_EQUAL(expected, (bool)((result >> step) & 1)); }
+         }
+      }
+   }
 };
 
 int main()
@@ -143,6 +667,11 @@ int main()
 
    LEP_RegisterFunction(0, fFalse);
    LEP_RegisterFunction(1, fTrue);
+   LEP_RegisterFunction(2, fTrue);
+   LEP_RegisterFunction(3, fFalse);
+   LEP_RegisterFunction(4, fSlowTrue);
+   LEP_RegisterFunction(5, fFalse);
+   LEP_RegisterFunction(6, fSwitch);
 
    CppUnit::TextUi::TestRunner runner;
    
@@ -11,19 +11,34 @@
 #include <cppunit/ui/text/TestRunner.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include "ast_node.h"
+#include "syntax_parser.h"
 #include "trigger.h"
 
+#define MAX_TEST_NODES (64)
+
+static bool s_inputs[NUMBER_OF_IO + NUMBER_OF_ALARMS];
+
+template <int FID> static bool fInput(void) { return s_inputs[FID]; }
+
 class TriggerTest : public CppUnit::TestFixture  {
 
    CPPUNIT_TEST_SUITE(TriggerTest);
-   
+
+   CPPUNIT_TEST(NewTriggerIsEvaluatedOnFirstUpdate);
+   CPPUNIT_TEST(OnlyDependentTriggersAreEvaluated);
+   CPPUNIT_TEST(UnchangedInputIsNotAChange);
+   CPPUNIT_TEST(ClearedTriggerIsNotEvaluated);
+   CPPUNIT_TEST(LongTriggerIsEvaluatedFromTree);
+
    CPPUNIT_TEST_SUITE_END();
 
 public:
 
    void setUp(void)
    {
-
+      memset(s_inputs, 0, sizeof(s_inputs));
+      Trigger_Init(&m_engine);
    }
 
    void tearDown(void)
@@ -32,14 +47,128 @@ public:
    }
 
 private:
-   
+
+   TriggerEngine m_engine;
+   ASTNode m_nodes[TRIGGER_MAX_COUNT][MAX_TEST_NODES]; // Trees too long to compile are kept
+
+   void set(uint16_t index, char const * text)
+   {
+      Parser parser;
+      ASTArena arena;
+      AST_InitArena(&arena, m_nodes[index], MAX_TEST_NODES);
+
+      CPPUNIT_ASSERT(Trigger_Set(&m_engine, index, LEP_Parse(&parser, text, &arena)));
+   }
+
+   void change(uint8_t fid, bool value)
+   {
+      s_inputs[fid] = value;
+      Trigger_SetInput(&m_engine, fid, value);
+   }
 
 protected:
 
+   void NewTriggerIsEvaluatedOnFirstUpdate()
+   {
+      set(0, "!0");
+      set(1, "0");
+      CPPUNIT_ASSERT_EQUAL((uint16_t)2, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(Trigger_Result(&m_engine, 0));
+      CPPUNIT_ASSERT(!Trigger_Result(&m_engine, 1));
+
+      CPPUNIT_ASSERT_EQUAL((uint16_t)0, Trigger_Update(&m_engine));
+   }
+
+   void OnlyDependentTriggersAreEvaluated()
+   {
+      set(0, "0&1");
+      set(1, "2|3");
+      set(2, "19&!4");
+      Trigger_Update(&m_engine);
+
+      change(1, true);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)1, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(!Trigger_Result(&m_engine, 0));
+
+      change(0, true);
+      change(19, true);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)2, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(Trigger_Result(&m_engine, 0));
+      CPPUNIT_ASSERT(!Trigger_Result(&m_engine, 1));
+      CPPUNIT_ASSERT(Trigger_Result(&m_engine, 2));
+
+      // Unrelated inputs leave the cached results alone
+      change(5, true);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)0, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(Trigger_Result(&m_engine, 2));
+
+      Trigger_MarkAllChanged(&m_engine);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)3, Trigger_Update(&m_engine));
+   }
+
+   void UnchangedInputIsNotAChange()
+   {
+      set(0, "0|1");
+      Trigger_Update(&m_engine);
+
+      change(0, false);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)0, Trigger_Update(&m_engine));
+
+      change(0, true);
+      change(0, true);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)1, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(Trigger_Result(&m_engine, 0));
+   }
+
+   void ClearedTriggerIsNotEvaluated()
+   {
+      set(0, "0");
+      Trigger_Update(&m_engine);
+      Trigger_Clear(&m_engine, 0);
+
+      Trigger_MarkChanged(&m_engine, 0);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)0, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(!Trigger_Set(&m_engine, TRIGGER_MAX_COUNT, NULL));
+   }
+
+   void LongTriggerIsEvaluatedFromTree()
+   {
+      static char const * const text = "!0|!1|!2|!3|!0|!1|!2|!3|!0|!1|!2|!3|!0|!1|!2|!3|!0|!1|!2|!3";
+      Parser parser;
+      LEPProgram program;
+
+      CPPUNIT_ASSERT(!LEP_Compile(LEP_Parse(&parser, text, NULL), &program));
+
+      set(0, text);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)1, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(Trigger_Result(&m_engine, 0));
+
+      change(0, true);
+      change(1, true);
+      change(2, true);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)1, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(Trigger_Result(&m_engine, 0));
+
+      change(3, true);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)1, Trigger_Update(&m_engine));
+      CPPUNIT_ASSERT(!Trigger_Result(&m_engine, 0));
+
+      change(4, true);
+      CPPUNIT_ASSERT_EQUAL((uint16_t)0, Trigger_Update(&m_engine));
+   }
 };
 
 int main()
 {
+   LEP_Init();
+
+   LEP_RegisterFunction(0, fInput<0>);
+   LEP_RegisterFunction(1, fInput<1>);
+   LEP_RegisterFunction(2, fInput<2>);
+   LEP_RegisterFunction(3, fInput<3>);
+   LEP_RegisterFunction(4, fInput<4>);
+   LEP_RegisterFunction(19, fInput<19>);
+
    CppUnit::TextUi::TestRunner runner;
    
    CPPUNIT_TEST_SUITE_REGISTRATION( TriggerTest );
@@ -23,10 +23,136 @@
 
 #include "alarm.h"
 
+/*
+ * Defines and typedefs
+ */
+
+#define SECONDS_PER_MINUTE (60UL)
+#define SECONDS_PER_HOUR (60UL * SECONDS_PER_MINUTE)
+#define SECONDS_PER_DAY (24UL * SECONDS_PER_HOUR)
+#define SECONDS_PER_WEEK (7UL * SECONDS_PER_DAY)
+
+#define MINUTES_PER_HOUR (60)
+#define MINUTES_PER_DAY (24 * MINUTES_PER_HOUR)
+#define MINUTES_PER_WEEK (7 * MINUTES_PER_DAY)
+
+/*
+ * Private Functions
+ */
+
+static UNIX_TIMESTAMP minute_floor(UNIX_TIMESTAMP seconds)
+{
+	return seconds - (seconds % SECONDS_PER_MINUTE);
+}
+
+static ALARM_MINUTE seconds_to_minute(UNIX_TIMESTAMP seconds)
+{
+	return (ALARM_MINUTE)(seconds / SECONDS_PER_MINUTE);
+}
+
+static UNIX_TIMESTAMP minute_to_seconds(ALARM_MINUTE minute)
+{
+	return (UNIX_TIMESTAMP)minute * SECONDS_PER_MINUTE;
+}
+
+/*
+ * days_from_civil
+ *
+ * Returns the number of days between 1st January 1970 and the given date.
+ * year is the full year (e.g. 1996), month is 1-12 and mday is 1-31.
+ * Only valid for dates on or after 1st March 0000.
+ */
+static long days_from_civil(long year, int month, int mday)
+{
+	year -= (month <= 2);
+	long era = year / 400;
+	long year_of_era = year - (era * 400);
+	long day_of_year = ((153 * (month + (month > 2 ? -3 : 9))) + 2) / 5 + mday - 1;
+	long day_of_era = (year_of_era * 365) + (year_of_era / 4) - (year_of_era / 100) + day_of_year;
+	return (era * 146097) + day_of_era - 719468;
+}
+
+static UNIX_TIMESTAMP calendar_to_seconds(int year, int mon, int mday, int hour, int min)
+{
+	UNIX_TIMESTAMP days = days_from_civil(year + 1900, mon + 1, mday);
+	return (days * SECONDS_PER_DAY) + (hour * SECONDS_PER_HOUR) + (min * SECONDS_PER_MINUTE);
+}
+
 /*
  * Public Functions
  */
 
+/*
+ * seconds_to_alarm_time
+ *
+ * Fills the calendar fields of tm from a UNIX timestamp (the inverse of days_from_civil).
+ */
+void seconds_to_alarm_time(UNIX_TIMESTAMP seconds, TM * tm)
+{
+	long days = (long)(seconds / SECONDS_PER_DAY);
+	long remainder = (long)(seconds % SECONDS_PER_DAY);
+
+	tm->tm_hour = remainder / SECONDS_PER_HOUR;
+	tm->tm_min = (remainder % SECONDS_PER_HOUR) / SECONDS_PER_MINUTE;
+	tm->tm_sec = remainder % SECONDS_PER_MINUTE;
+	tm->tm_wday = (days + THU) % 7; // 1st January 1970 was a Thursday
+
+	long z = days + 719468;
+	long era = z / 146097;
+	long day_of_era = z - (era * 146097);
+	long year_of_era = (day_of_era - (day_of_era / 1460) + (day_of_era / 36524) - (day_of_era / 146096)) / 365;
+	long day_of_year = day_of_era - ((365 * year_of_era) + (year_of_era / 4) - (year_of_era / 100));
+	long mp = ((5 * day_of_year) + 2) / 153;
+	int month = mp < 10 ? mp + 3 : mp - 9;
+	long year = year_of_era + (era * 400) + (month <= 2);
+
+	tm->tm_mday = day_of_year - (((153 * mp) + 2) / 5) + 1;
+	tm->tm_mon = month - 1;
+	tm->tm_year = year - 1900;
+	tm->tm_yday = days - days_from_civil(year, 1, 1);
+	tm->tm_isdst = 0;
+}
+
+/*
+ * alarm_time_to_seconds
+ *
+ * Converts the date and time fields of tm (ignoring weekday and day-of-year) to a UNIX timestamp.
+ */
+UNIX_TIMESTAMP alarm_time_to_seconds(TM const * const tm)
+{
+	return calendar_to_seconds(tm->tm_year, tm->tm_mon, tm->tm_mday, tm->tm_hour, tm->tm_min) + tm->tm_sec;
+}
+
+/*
+ * alarm_time_to_minute
+ *
+ * Equivalent to time_to_unix_seconds(tm) / 60, but the calendar conversion is only
+ * done when the date changes. The cache is shared by all alarms (which are normally
+ * polled with the same time), so each tick costs a few compares and multiplies.
+ */
+ALARM_MINUTE alarm_time_to_minute(TM const * const tm)
+{
+	static int s_cached_year = -1;
+	static int s_cached_mon = -1;
+	static int s_cached_mday = -1;
+	static ALARM_MINUTE s_cached_day_minute;
+
+	if ((tm->tm_mday != s_cached_mday) || (tm->tm_mon != s_cached_mon) || (tm->tm_year != s_cached_year))
+	{
+		TM date = *tm;
+		date.tm_hour = 0;
+		date.tm_min = 0;
+		date.tm_sec = 0;
+		s_cached_day_minute = seconds_to_minute(time_to_unix_seconds(&date));
+		s_cached_year = tm->tm_year;
+		s_cached_mon = tm->tm_mon;
+		s_cached_mday = tm->tm_mday;
+	}
+
+	unsigned long second_of_day = (tm->tm_hour * SECONDS_PER_HOUR) + (tm->tm_min * SECONDS_PER_MINUTE) + tm->tm_sec;
+	return s_cached_day_minute + (ALARM_MINUTE)(second_of_day / SECONDS_PER_MINUTE);
+}
+
 void set_default_alarm_time(TM* tm)
 {
 	// Reset to 1st January 2000
@@ -59,64 +185,537 @@ Alarm::Alarm(INTERVAL interval, TM const * const alarm_time, int repeat, int dur
 	m_current_trigger_count = 0;
 	m_duration = duration ? duration : 60;
     m_triggered = false;
+    m_last_update_minute = ALARM_MINUTE_NEVER;
+
+    compile_match_masks();
 
     m_valid = true;
 }
 
-void Alarm::update_deactivate_time(TM const * const current_time)
+/*
+ * compile_match_masks
+ *
+ * Converts the alarm time into one bitmask per field, with every bit set for
+ * fields that this interval does not compare.
+ */
+void Alarm::compile_match_masks()
 {
-	m_deactivate_time_seconds = time_to_unix_seconds(current_time) + (m_duration * 60);
+	m_minute_mask = (uint64_t)1 << (m_datetime.tm_min & 63);
+	m_hour_mask = ALARM_ANY_HOUR;
+	m_mday_mask = ALARM_ANY_MDAY;
+	m_month_mask = ALARM_ANY_MONTH;
+	m_wday_mask = ALARM_ANY_WDAY;
+	m_extra_matches = false;
+
+	switch (m_alarm_interval_period)
+	{
+	case INTERVAL_YEAR:
+		m_month_mask = (uint16_t)(1U << (m_datetime.tm_mon & 15));
+		// Deliberate fall-through!
+	case INTERVAL_MONTH:
+		m_mday_mask = (uint32_t)1 << (m_datetime.tm_mday & 31);
+		// Deliberate fall-through!
+	case INTERVAL_DAY:
+		m_hour_mask = (uint32_t)1 << (m_datetime.tm_hour & 31);
+		// Deliberate fall-through!
+	case INTERVAL_HOUR:
+		break;
+	case INTERVAL_WEEK:
+		// Weekly interval is a special case
+		m_wday_mask = (uint8_t)(1U << (m_datetime.tm_wday & 7));
+		m_hour_mask = (uint32_t)1 << (m_datetime.tm_hour & 31);
+		break;
+	default:
+		m_minute_mask = ALARM_ANY_MINUTE;
+		break;
+	}
 }
 
-bool Alarm::set_current_time(TM const * const current_time)
+/*
+ * add_match
+ *
+ * Adds the fields of another time to those this alarm matches, e.g. adding
+ * 15, 30 and 45 minutes to an hourly alarm at 00 gives a quarter-hourly alarm.
+ * As with cron, each field matches independently: adding 10:30 to a daily
+ * alarm at 08:00 also matches 08:30 and 10:00.
+ */
+bool Alarm::add_match(TM const * const time)
 {
-	if (!current_time) { return false; }
+	if (!time) { return false; }
 
-	if (!m_triggered)
+	m_minute_mask |= (uint64_t)1 << (time->tm_min & 63);
+
+	switch (m_alarm_interval_period)
 	{
-		bool times_match = true;
+	case INTERVAL_YEAR:
+		m_month_mask |= (uint16_t)(1U << (time->tm_mon & 15));
+		// Deliberate fall-through!
+	case INTERVAL_MONTH:
+		m_mday_mask |= (uint32_t)1 << (time->tm_mday & 31);
+		// Deliberate fall-through!
+	case INTERVAL_DAY:
+		m_hour_mask |= (uint32_t)1 << (time->tm_hour & 31);
+		// Deliberate fall-through!
+	case INTERVAL_HOUR:
+		break;
+	case INTERVAL_WEEK:
+		m_wday_mask |= (uint8_t)(1U << (time->tm_wday & 7));
+		m_hour_mask |= (uint32_t)1 << (time->tm_hour & 31);
+		break;
+	default:
+		return false;
+	}
 
-		switch (m_alarm_interval_period)
-		{
-		case INTERVAL_YEAR:
-			times_match &= (m_datetime.tm_mon == current_time->tm_mon);
-			// Deliberate fall-through!
-		case INTERVAL_MONTH:
-			times_match &= (m_datetime.tm_mday == current_time->tm_mday);
-			// Deliberate fall-through!
-		case INTERVAL_DAY:
-			times_match &= (m_datetime.tm_hour == current_time->tm_hour);
-			// Deliberate fall-through!
-		case INTERVAL_HOUR:
-			times_match &= (m_datetime.tm_min == current_time->tm_min);
-			break;
-		case INTERVAL_WEEK:
-			// Weekly interval is a special case
-			times_match &= (m_datetime.tm_wday == current_time->tm_wday);
-			times_match &= (m_datetime.tm_hour == current_time->tm_hour);
-			times_match &= (m_datetime.tm_min == current_time->tm_min);
-			break;
-		}
+	m_extra_matches = true;
+	return true;
+}
+
+/*
+ * times_match
+ *
+ * True if every field of time is permitted by the compiled masks.
+ */
+bool Alarm::times_match(TM const * const time) const
+{
+	uint32_t match = (uint32_t)(m_minute_mask >> (time->tm_min & 63));
+	match &= m_hour_mask >> (time->tm_hour & 31);
+	match &= m_mday_mask >> (time->tm_mday & 31);
+	match &= (uint32_t)m_month_mask >> (time->tm_mon & 15);
+	match &= (uint32_t)m_wday_mask >> (time->tm_wday & 7);
+	return match & 1;
+}
+
+/*
+ * minute_matches
+ *
+ * As times_match, but for a minute of the internal clock. The date fields are
+ * only recalculated when the day changes, and the cache is shared by all alarms
+ * (which are normally polled with the same time).
+ */
+bool Alarm::minute_matches(ALARM_MINUTE minute) const
+{
+	static ALARM_MINUTE s_cached_day = ALARM_MINUTE_NEVER;
+	static uint32_t s_cached_mon;
+	static uint32_t s_cached_mday;
+	static uint32_t s_cached_wday;
 
-		if (times_match) { m_current_trigger_count++; }
+	ALARM_MINUTE day = minute / MINUTES_PER_DAY;
+	int minute_of_day = minute % MINUTES_PER_DAY;
+
+	if (day != s_cached_day)
+	{
+		TM date;
+		seconds_to_alarm_time(minute_to_seconds(day * MINUTES_PER_DAY), &date);
+		s_cached_mon = date.tm_mon;
+		s_cached_mday = date.tm_mday;
+		s_cached_wday = date.tm_wday;
+		s_cached_day = day;
+	}
+
+	uint32_t match = (uint32_t)(m_minute_mask >> (minute_of_day % MINUTES_PER_HOUR));
+	match &= m_hour_mask >> (minute_of_day / MINUTES_PER_HOUR);
+	match &= m_mday_mask >> s_cached_mday;
+	match &= (uint32_t)m_month_mask >> s_cached_mon;
+	match &= (uint32_t)m_wday_mask >> s_cached_wday;
+	return match & 1;
+}
+
+void Alarm::update_deactivate_time(ALARM_MINUTE current_minute)
+{
+	m_deactivate_minute = current_minute + m_duration;
+}
+
+/*
+ * update
+ *
+ * Moves the alarm on to the given minute. match is only used if the alarm is not triggered.
+ */
+bool Alarm::update(ALARM_MINUTE minute, bool match)
+{
+	if (!m_triggered)
+	{
+		if (match) { m_current_trigger_count++; }
 
 		m_triggered = (m_current_trigger_count == m_alarm_interval_count);
 
 		if (m_triggered)
 		{
 			m_current_trigger_count = 0;
-			update_deactivate_time(current_time);
+			update_deactivate_time(minute);
 		}
 	}
 	else
 	{
-		UNIX_TIMESTAMP current_time_seconds = time_to_unix_seconds(current_time);
-		m_triggered = current_time_seconds <= m_deactivate_time_seconds;
+		m_triggered = minute <= m_deactivate_minute;
 	}
 
+	m_last_update_minute = minute;
+
 	return m_triggered;
 }
 
+bool Alarm::set_current_time(TM const * const current_time)
+{
+	if (!current_time) { return false; }
+
+	// The fields of current_time are matched as given, the clock is only used for the duration
+	ALARM_MINUTE minute = alarm_time_to_minute(current_time);
+
+	return update(minute, !m_triggered && times_match(current_time));
+}
+
+bool Alarm::set_current_time(UNIX_TIMESTAMP current_time)
+{
+	ALARM_MINUTE minute = seconds_to_minute(current_time);
+
+	return update(minute, !m_triggered && minute_matches(minute));
+}
+
+/*
+ * advance_to
+ *
+ * Brings the alarm to the state it would have if set_current_time had been called
+ * for every minute since the last update, up to and including new_time, without
+ * visiting each minute: the repeat count jumps by the number of matches in the
+ * skipped span, and for fixed-period intervals whole trigger/expire cycles are
+ * skipped in one step. If the clock has gone backwards (or the alarm has never
+ * been updated) this is the same as a single call to set_current_time.
+ */
+bool Alarm::advance_to(TM const * const new_time)
+{
+	if (!new_time) { return false; }
+
+	return advance_to(time_to_unix_seconds(new_time));
+}
+
+bool Alarm::advance_to(UNIX_TIMESTAMP new_time)
+{
+	ALARM_MINUTE end = seconds_to_minute(new_time);
+
+	if ((m_last_update_minute == ALARM_MINUTE_NEVER) || (end <= m_last_update_minute))
+	{
+		return set_current_time(new_time);
+	}
+
+	UNIX_TIMESTAMP end_seconds = minute_to_seconds(end);
+	UNIX_TIMESTAMP t = minute_to_seconds(m_last_update_minute + 1); // First skipped minute
+	UNIX_TIMESTAMP period = match_period();
+	bool cycles_skipped = false;
+
+	while (t <= end_seconds)
+	{
+		if (m_triggered)
+		{
+			UNIX_TIMESTAMP expiry = expiry_time();
+			if (expiry > end_seconds) { break; }
+
+			m_triggered = false;
+			t = expiry + SECONDS_PER_MINUTE; // The expiry minute itself is not counted
+			continue;
+		}
+
+		if (m_alarm_interval_count < 1) { break; }
+
+		int matches_needed = m_alarm_interval_count - m_current_trigger_count;
+		UNIX_TIMESTAMP trigger = nth_match_from(t, matches_needed);
+
+		if (trigger > end_seconds)
+		{
+			m_current_trigger_count += count_matches(t, end_seconds, matches_needed - 1);
+			break;
+		}
+
+		m_triggered = true;
+		m_current_trigger_count = 0;
+		update_deactivate_time(seconds_to_minute(trigger));
+
+		if (period && !cycles_skipped)
+		{
+			// Every trigger/expire cycle from here on is identical, so skip straight to the last one
+			UNIX_TIMESTAMP cycle = next_trigger_time(trigger + SECONDS_PER_MINUTE) - trigger;
+			trigger += ((end_seconds - trigger) / cycle) * cycle;
+			update_deactivate_time(seconds_to_minute(trigger));
+			cycles_skipped = true;
+		}
+
+		t = trigger + SECONDS_PER_MINUTE;
+	}
+
+	m_last_update_minute = end;
+
+	return m_triggered;
+}
+
+/*
+ * match_period
+ *
+ * Returns the fixed time between matches for hourly, daily and weekly alarms,
+ * or 0 for alarms whose matches are not evenly spaced.
+ */
+UNIX_TIMESTAMP Alarm::match_period() const
+{
+	if (m_extra_matches) { return 0; }
+
+	switch (m_alarm_interval_period)
+	{
+	case INTERVAL_HOUR: return SECONDS_PER_HOUR;
+	case INTERVAL_DAY: return SECONDS_PER_DAY;
+	case INTERVAL_WEEK: return SECONDS_PER_WEEK;
+	default: return 0;
+	}
+}
+
+/*
+ * count_matches
+ *
+ * Returns the number of matching minutes from "from" to "to" inclusive, counting no further than limit.
+ */
+int Alarm::count_matches(UNIX_TIMESTAMP from, UNIX_TIMESTAMP to, int limit) const
+{
+	UNIX_TIMESTAMP period = match_period();
+	int count = 0;
+
+	if (period)
+	{
+		UNIX_TIMESTAMP first = nth_match_from(from, 1);
+		if (first > to) { return 0; }
+		count = 1 + ((to - first) / period);
+		return (count < limit) ? count : limit;
+	}
+
+	while (count < limit)
+	{
+		from = nth_match_from(from, 1);
+		if (from > to) { break; }
+		count++;
+		from += SECONDS_PER_MINUTE;
+	}
+
+	return count;
+}
+
+/*
+ * nth_match_from
+ *
+ * Returns the start of the nth minute (counting from 1) at or after "from" whose
+ * fields match this alarm. Intervals with a fixed period are a single division;
+ * monthly and yearly alarms step over whole months/years, skipping those which
+ * do not contain the alarm date (e.g. the 31st, or 29th February).
+ */
+UNIX_TIMESTAMP Alarm::nth_match_from(UNIX_TIMESTAMP from, int n) const
+{
+	if (m_extra_matches)
+	{
+		// More than one match per interval, so search the masks for each match in turn
+		while (true)
+		{
+			from = next_mask_match_from(from);
+			if ((from == ALARM_NEVER) || (--n == 0)) { return from; }
+			from += SECONDS_PER_MINUTE;
+		}
+	}
+
+	TM from_tm;
+	seconds_to_alarm_time(from, &from_tm);
+
+	int alarm_minute_of_day = (m_datetime.tm_hour * MINUTES_PER_HOUR) + m_datetime.tm_min;
+	int from_minute_of_day = (from_tm.tm_hour * MINUTES_PER_HOUR) + from_tm.tm_min;
+	int offset;
+
+	UNIX_TIMESTAMP candidate;
+
+	switch (m_alarm_interval_period)
+	{
+	case INTERVAL_HOUR:
+		offset = (m_datetime.tm_min - from_tm.tm_min + MINUTES_PER_HOUR) % MINUTES_PER_HOUR;
+		return from + (offset * SECONDS_PER_MINUTE) + ((n - 1) * SECONDS_PER_HOUR);
+
+	case INTERVAL_DAY:
+		offset = (alarm_minute_of_day - from_minute_of_day + MINUTES_PER_DAY) % MINUTES_PER_DAY;
+		return from + (offset * SECONDS_PER_MINUTE) + ((n - 1) * SECONDS_PER_DAY);
+
+	case INTERVAL_WEEK:
+		offset = (m_datetime.tm_wday * MINUTES_PER_DAY) + alarm_minute_of_day;
+		offset -= (from_tm.tm_wday * MINUTES_PER_DAY) + from_minute_of_day;
+		offset = (offset + MINUTES_PER_WEEK) % MINUTES_PER_WEEK;
+		return from + (offset * SECONDS_PER_MINUTE) + ((n - 1) * SECONDS_PER_WEEK);
+
+	case INTERVAL_MONTH:
+		if ((m_datetime.tm_mday < 1) || (m_datetime.tm_mday > 31)) { return ALARM_NEVER; }
+
+		while (true)
+		{
+			if (days_in_month_valid(m_datetime.tm_mday, from_tm.tm_mon, from_tm.tm_year))
+			{
+				candidate = calendar_to_seconds(from_tm.tm_year, from_tm.tm_mon,
+					m_datetime.tm_mday, m_datetime.tm_hour, m_datetime.tm_min);
+
+				if ((candidate >= from) && (--n == 0)) { return candidate; }
+			}
+
+			if (++from_tm.tm_mon > DEC)
+			{
+				from_tm.tm_mon = JAN;
+				from_tm.tm_year++;
+			}
+		}
+
+	case INTERVAL_YEAR:
+		// 2000 was a leap year, so this rejects only dates that can never occur
+		if (!days_in_month_valid(m_datetime.tm_mday, m_datetime.tm_mon, 100)) { return ALARM_NEVER; }
+
+		while (true)
+		{
+			if (days_in_month_valid(m_datetime.tm_mday, m_datetime.tm_mon, from_tm.tm_year))
+			{
+				candidate = calendar_to_seconds(from_tm.tm_year, m_datetime.tm_mon,
+					m_datetime.tm_mday, m_datetime.tm_hour, m_datetime.tm_min);
+
+				if ((candidate >= from) && (--n == 0)) { return candidate; }
+			}
+
+			from_tm.tm_year++;
+		}
+	}
+
+	return ALARM_NEVER;
+}
+
+/*
+ * next_mask_match_from
+ *
+ * Returns the start of the first minute at or after "from" permitted by the match
+ * masks, skipping whole months, days and hours that cannot match.
+ * Gives up after nine years (enough to find a 29th February).
+ */
+UNIX_TIMESTAMP Alarm::next_mask_match_from(UNIX_TIMESTAMP from) const
+{
+	UNIX_TIMESTAMP limit = from + (9 * 366 * SECONDS_PER_DAY);
+	uint64_t valid_minutes = m_minute_mask & (((uint64_t)1 << MINUTES_PER_HOUR) - 1);
+	TM t;
+
+	while (from < limit)
+	{
+		seconds_to_alarm_time(from, &t);
+
+		if (!((m_month_mask >> t.tm_mon) & 1))
+		{
+			t.tm_mon++;
+			t.tm_mday = 1;
+			t.tm_hour = 0;
+			t.tm_min = 0;
+		}
+		else if (!((m_mday_mask >> t.tm_mday) & 1) || !((m_wday_mask >> t.tm_wday) & 1))
+		{
+			t.tm_mday++;
+			t.tm_hour = 0;
+			t.tm_min = 0;
+		}
+		else if (!((m_hour_mask >> t.tm_hour) & 1))
+		{
+			t.tm_hour++;
+			t.tm_min = 0;
+		}
+		else
+		{
+			uint64_t minutes = valid_minutes >> t.tm_min;
+			if (minutes) { return from + (__builtin_ctzll(minutes) * SECONDS_PER_MINUTE); }
+
+			t.tm_hour++;
+			t.tm_min = 0;
+		}
+
+		// alarm_time_to_seconds handles the carries (e.g. hour 24, day 32, month 12)
+		t.tm_sec = 0;
+		from = alarm_time_to_seconds(&t);
+	}
+
+	return ALARM_NEVER;
+}
+
+/*
+ * next_trigger_time
+ *
+ * Returns the start of the minute at which set_current_time will next report this
+ * alarm as triggered, assuming it is called once per minute starting at "now".
+ * If the alarm is already triggered, the search starts once the duration window
+ * has closed (the minute after the alarm deactivates, as that minute is not counted).
+ */
+UNIX_TIMESTAMP Alarm::next_trigger_time(TM const * const now) const
+{
+	if (!now) { return ALARM_NEVER; }
+
+	return next_trigger_time(time_to_unix_seconds(now));
+}
+
+UNIX_TIMESTAMP Alarm::next_trigger_time(UNIX_TIMESTAMP now) const
+{
+	UNIX_TIMESTAMP from = minute_floor(now);
+	int matches_needed = m_alarm_interval_count - m_current_trigger_count;
+
+	if (m_alarm_interval_count < 1) { return ALARM_NEVER; }
+
+	if (m_triggered)
+	{
+		UNIX_TIMESTAMP window_end = expiry_time() + SECONDS_PER_MINUTE;
+		if (window_end > from) { from = window_end; }
+		matches_needed = m_alarm_interval_count;
+	}
+
+	if (matches_needed < 1) { matches_needed = 1; }
+
+	return nth_match_from(from, matches_needed);
+}
+
+/*
+ * next_deadline
+ *
+ * Returns the next time at which this alarm changes state: when it is triggered,
+ * the minute at which it expires, otherwise the time it next triggers.
+ */
+UNIX_TIMESTAMP Alarm::next_deadline(UNIX_TIMESTAMP now) const
+{
+	return m_triggered ? expiry_time() : next_trigger_time(now);
+}
+
+/*
+ * process_deadline
+ *
+ * Applies the state change that next_deadline() predicted, without the alarm having
+ * been polled in between. was_triggered is the value of is_triggered() when that
+ * deadline was calculated: if the alarm has since been changed externally (e.g. deactivated)
+ * no change is made. Returns true if is_triggered() changed, and the next deadline
+ * through next_deadline.
+ */
+bool Alarm::process_deadline(UNIX_TIMESTAMP deadline, bool was_triggered, UNIX_TIMESTAMP * next_deadline)
+{
+	bool triggered = m_triggered;
+	UNIX_TIMESTAMP resume_from = deadline;
+
+	if (!was_triggered && !m_triggered)
+	{
+		m_triggered = true;
+		m_current_trigger_count = 0;
+		update_deactivate_time(seconds_to_minute(deadline));
+	}
+	else if (was_triggered && m_triggered && (seconds_to_minute(deadline) > m_deactivate_minute))
+	{
+		m_triggered = false;
+		resume_from = deadline + SECONDS_PER_MINUTE; // The expiry minute itself is not counted
+	}
+
+	m_last_update_minute = seconds_to_minute(deadline);
+
+	if (next_deadline) { *next_deadline = this->next_deadline(resume_from); }
+
+	return triggered != m_triggered;
+}
+
+UNIX_TIMESTAMP Alarm::expiry_time() const
+{
+	return minute_to_seconds(m_deactivate_minute + 1);
+}
+
 void Alarm::reset()
 {
 	set_default_alarm_time(&m_datetime);
@@ -125,6 +724,9 @@ void Alarm::reset()
 	m_duration = 60;
 	m_current_trigger_count = 0;
     m_triggered = false;
+    m_last_update_minute = ALARM_MINUTE_NEVER;
+
+    compile_match_masks();
 }
 
 bool operator==(const Alarm& lhs, const Alarm& rhs)
@@ -136,6 +738,12 @@ bool operator==(const Alarm& lhs, const Alarm& rhs)
 	equal &= (lhs.m_alarm_interval_period == rhs.m_alarm_interval_period);
 	equal &= (lhs.m_duration == rhs.m_duration);
 
+	equal &= (lhs.m_minute_mask == rhs.m_minute_mask);
+	equal &= (lhs.m_hour_mask == rhs.m_hour_mask);
+	equal &= (lhs.m_mday_mask == rhs.m_mday_mask);
+	equal &= (lhs.m_month_mask == rhs.m_month_mask);
+	equal &= (lhs.m_wday_mask == rhs.m_wday_mask);
+
 	return equal;
 }
 
@@ -19,6 +19,20 @@ enum interval
 };
 typedef enum interval INTERVAL;
 
+// Returned by next_trigger_time for alarms that can never trigger
+#define ALARM_NEVER ((UNIX_TIMESTAMP)-1)
+
+// Internal alarm clock: whole minutes since 1st January 1970 (good until the year 10000)
+typedef uint32_t ALARM_MINUTE;
+#define ALARM_MINUTE_NEVER ((ALARM_MINUTE)-1)
+
+// Match masks for fields an interval does not compare
+#define ALARM_ANY_MINUTE (~(uint64_t)0)
+#define ALARM_ANY_HOUR (~(uint32_t)0)
+#define ALARM_ANY_MDAY (~(uint32_t)0)
+#define ALARM_ANY_MONTH ((uint16_t)0xFFFF)
+#define ALARM_ANY_WDAY ((uint8_t)0xFF)
+
 /*
  * Public Function Prototypes
  */
@@ -46,6 +60,8 @@ public:
 	Alarm(INTERVAL interval, TM const * const time, int interval_count, int duration);
 
 	friend bool operator==(const Alarm& lhs, const Alarm& rhs);
+	friend class AlarmTable;
+	friend class PackedAlarm;
 
 	void reset();
 	bool valid() { return m_valid; }
@@ -58,12 +74,32 @@ public:
 
 	bool to_string(ALARM_STRING * str) const;
 
+	bool add_match(TM const * const time);
+
 	bool set_current_time(TM const * const time);
+	bool set_current_time(UNIX_TIMESTAMP time);
+	bool advance_to(TM const * const new_time);
+	bool advance_to(UNIX_TIMESTAMP new_time);
+	UNIX_TIMESTAMP next_trigger_time(TM const * const now) const;
+	UNIX_TIMESTAMP next_trigger_time(UNIX_TIMESTAMP now) const;
+
+	UNIX_TIMESTAMP next_deadline(UNIX_TIMESTAMP now) const;
+	bool process_deadline(UNIX_TIMESTAMP deadline, bool was_triggered, UNIX_TIMESTAMP * next_deadline);
 	bool is_triggered() { return m_triggered; }
 	void deactivate() { m_triggered = false; }
 private:
 
-	void update_deactivate_time(TM const * const current_time);
+	bool update(ALARM_MINUTE minute, bool match);
+	void update_deactivate_time(ALARM_MINUTE current_minute);
+	UNIX_TIMESTAMP expiry_time() const;
+	UNIX_TIMESTAMP match_period() const;
+	int count_matches(UNIX_TIMESTAMP from, UNIX_TIMESTAMP to, int limit) const;
+	UNIX_TIMESTAMP nth_match_from(UNIX_TIMESTAMP from, int n) const;
+	UNIX_TIMESTAMP next_mask_match_from(UNIX_TIMESTAMP from) const;
+
+	void compile_match_masks();
+	bool times_match(TM const * const time) const;
+	bool minute_matches(ALARM_MINUTE minute) const;
 
 	TM m_datetime;
 	int m_alarm_interval_count;	// Interval number - e.g if this is 2 for a weekly interval, the alarm will go off fortnightly.
@@ -72,7 +108,16 @@ private:
 	int m_current_trigger_count;
 	bool m_triggered;
 	bool m_valid;
-	UNIX_TIMESTAMP m_deactivate_time_seconds;
+	ALARM_MINUTE m_deactivate_minute; // Last minute of the duration window
+	ALARM_MINUTE m_last_update_minute; // Minute of the last set_current_time/advance_to, or ALARM_MINUTE_NEVER
+
+	// One bit per permitted field value, compiled from m_datetime and the interval
+	uint64_t m_minute_mask;
+	uint32_t m_hour_mask;
+	uint32_t m_mday_mask;
+	uint16_t m_month_mask;
+	uint8_t m_wday_mask;
+	bool m_extra_matches; // add_match has been used, so there may be more than one match per interval
 };
 
 #ifdef TEST
@@ -97,5 +142,8 @@ namespace CppUnit
 #endif
 
 void set_default_alarm_time(TM* tm);
+void seconds_to_alarm_time(UNIX_TIMESTAMP seconds, TM * tm);
+UNIX_TIMESTAMP alarm_time_to_seconds(TM const * const tm);
+ALARM_MINUTE alarm_time_to_minute(TM const * const tm);
 
 #endif
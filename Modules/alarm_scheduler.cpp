@@ -0,0 +1,171 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef TEST
+#include <cppunit/TestAssert.h>
+#endif
+
+/*
+ * Code Library Includes
+ */
+
+#include "Utility/util_time.h"
+
+/*
+ * Application Includes
+ */
+
+#include "alarm.h"
+#include "alarm_scheduler.h"
+
+/*
+ * AlarmScheduler Class
+ */
+
+AlarmScheduler::AlarmScheduler(ALARM_SCHEDULE_ENTRY * storage, int capacity)
+{
+	m_entries = storage;
+	m_capacity = storage ? capacity : 0;
+	m_count = 0;
+}
+
+/*
+ * add
+ *
+ * Schedules an alarm from "now", which is the next time that would have been passed
+ * to the alarm's set_current_time. O(log n).
+ */
+bool AlarmScheduler::add(Alarm * alarm, UNIX_TIMESTAMP now)
+{
+	if (!alarm) { return false; }
+	if (m_count >= m_capacity) { return false; }
+
+	ALARM_SCHEDULE_ENTRY * entry = &m_entries[m_count];
+	entry->alarm = alarm;
+	entry->was_triggered = alarm->is_triggered();
+	entry->deadline = alarm->next_deadline(now);
+
+	sift_up(m_count++);
+
+	return true;
+}
+
+/*
+ * remove
+ *
+ * Unschedules an alarm. Finding the alarm is O(n), restoring the heap is O(log n).
+ */
+bool AlarmScheduler::remove(Alarm * alarm)
+{
+	int index = find(alarm);
+
+	if (index < 0) { return false; }
+
+	m_count--;
+
+	if (index != m_count)
+	{
+		m_entries[index] = m_entries[m_count];
+		sift_up(index);
+		sift_down(index);
+	}
+
+	return true;
+}
+
+/*
+ * rearm
+ *
+ * Reschedules an alarm after it has been changed by the application
+ * (e.g. deactivated early, or replaced with a new setting).
+ */
+bool AlarmScheduler::rearm(Alarm * alarm, UNIX_TIMESTAMP now)
+{
+	(void)remove(alarm);
+	return add(alarm, now);
+}
+
+/*
+ * pop_due
+ *
+ * Applies every state change due at or before "now", writing each alarm whose
+ * is_triggered() state changed into "due" (at most max_due of them; any others
+ * remain due for the next call). An alarm that both triggered and expired before
+ * "now" appears twice. Returns the number of alarms written.
+ */
+int AlarmScheduler::pop_due(UNIX_TIMESTAMP now, Alarm ** due, int max_due)
+{
+	int n = 0;
+
+	if (!due) { return 0; }
+
+	while ((m_count > 0) && (n < max_due) && (m_entries[0].deadline <= now))
+	{
+		ALARM_SCHEDULE_ENTRY * entry = &m_entries[0];
+
+		if (entry->alarm->process_deadline(entry->deadline, entry->was_triggered, &entry->deadline))
+		{
+			due[n++] = entry->alarm;
+		}
+
+		entry->was_triggered = entry->alarm->is_triggered();
+		sift_down(0);
+	}
+
+	return n;
+}
+
+UNIX_TIMESTAMP AlarmScheduler::next_deadline() const
+{
+	return (m_count > 0) ? m_entries[0].deadline : ALARM_NEVER;
+}
+
+int AlarmScheduler::find(Alarm * alarm) const
+{
+	int i;
+	for (i = 0; i < m_count; ++i)
+	{
+		if (m_entries[i].alarm == alarm) { return i; }
+	}
+	return -1;
+}
+
+void AlarmScheduler::swap(int a, int b)
+{
+	ALARM_SCHEDULE_ENTRY temp = m_entries[a];
+	m_entries[a] = m_entries[b];
+	m_entries[b] = temp;
+}
+
+void AlarmScheduler::sift_up(int index)
+{
+	while (index > 0)
+	{
+		int parent = (index - 1) / 2;
+		if (m_entries[parent].deadline <= m_entries[index].deadline) { break; }
+		swap(parent, index);
+		index = parent;
+	}
+}
+
+void AlarmScheduler::sift_down(int index)
+{
+	while (true)
+	{
+		int smallest = index;
+		int left = (2 * index) + 1;
+		int right = left + 1;
+
+		if ((left < m_count) && (m_entries[left].deadline < m_entries[smallest].deadline)) { smallest = left; }
+		if ((right < m_count) && (m_entries[right].deadline < m_entries[smallest].deadline)) { smallest = right; }
+
+		if (smallest == index) { break; }
+
+		swap(smallest, index);
+		index = smallest;
+	}
+}
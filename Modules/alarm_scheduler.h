@@ -0,0 +1,49 @@
+#ifndef _ALARM_SCHEDULER_H_
+#define _ALARM_SCHEDULER_H_
+
+/*
+ * Defines and typedefs
+ */
+
+struct alarm_schedule_entry
+{
+	UNIX_TIMESTAMP deadline;
+	Alarm * alarm;
+	bool was_triggered; // Alarm state when deadline was calculated
+};
+typedef struct alarm_schedule_entry ALARM_SCHEDULE_ENTRY;
+
+/*
+ * AlarmScheduler
+ *
+ * Keeps alarms in a binary min-heap ordered by the time they next change state,
+ * so that a tick only touches the alarms that are due. Storage for the heap is
+ * provided by the application.
+ */
+
+class AlarmScheduler
+{
+public:
+	AlarmScheduler(ALARM_SCHEDULE_ENTRY * storage, int capacity);
+
+	bool add(Alarm * alarm, UNIX_TIMESTAMP now);
+	bool remove(Alarm * alarm);
+	bool rearm(Alarm * alarm, UNIX_TIMESTAMP now);
+
+	int pop_due(UNIX_TIMESTAMP now, Alarm ** due, int max_due);
+
+	UNIX_TIMESTAMP next_deadline() const;
+	int count() const { return m_count; }
+
+private:
+	int find(Alarm * alarm) const;
+	void swap(int a, int b);
+	void sift_up(int index);
+	void sift_down(int index);
+
+	ALARM_SCHEDULE_ENTRY * m_entries;
+	int m_capacity;
+	int m_count;
+};
+
+#endif
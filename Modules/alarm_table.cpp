@@ -0,0 +1,287 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef TEST
+#include <cppunit/TestAssert.h>
+#endif
+
+#if defined(__AVX2__) && !defined(ALARM_TABLE_NO_SIMD)
+#include <immintrin.h>
+#define ALARM_TABLE_AVX2
+#elif defined(__SSE2__) && !defined(ALARM_TABLE_NO_SIMD)
+#include <emmintrin.h>
+#define ALARM_TABLE_SSE2
+#endif
+
+/*
+ * Code Library Includes
+ */
+
+#include "Utility/util_time.h"
+
+/*
+ * Application Includes
+ */
+
+#include "alarm.h"
+#include "alarm_table.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define FIELD_ANY (0xFF) // Field is not compared for this interval
+#define FIELD_UNUSED (0xFE) // Slot is empty: never matches
+
+#define BLOCK(index) ((index) / ALARM_TABLE_BLOCK)
+#define BIT(index) (1UL << ((index) % ALARM_TABLE_BLOCK))
+
+/*
+ * Private Functions
+ */
+
+#if defined(ALARM_TABLE_AVX2)
+
+static __m256i field_matches(uint8_t const * field, uint8_t value)
+{
+	__m256i fields = _mm256_loadu_si256((__m256i const *)field);
+	__m256i equal = _mm256_cmpeq_epi8(fields, _mm256_set1_epi8((char)value));
+	__m256i any = _mm256_cmpeq_epi8(fields, _mm256_set1_epi8((char)FIELD_ANY));
+	return _mm256_or_si256(equal, any);
+}
+
+#elif defined(ALARM_TABLE_SSE2)
+
+static __m128i field_matches(uint8_t const * field, uint8_t value)
+{
+	__m128i fields = _mm_loadu_si128((__m128i const *)field);
+	__m128i equal = _mm_cmpeq_epi8(fields, _mm_set1_epi8((char)value));
+	__m128i any = _mm_cmpeq_epi8(fields, _mm_set1_epi8((char)FIELD_ANY));
+	return _mm_or_si128(equal, any);
+}
+
+#else
+
+static bool field_matches(uint8_t field, uint8_t value)
+{
+	return (field == value) || (field == FIELD_ANY);
+}
+
+#endif
+
+/*
+ * AlarmTable Class
+ */
+
+AlarmTable::AlarmTable()
+{
+	int i;
+	memset(m_triggered, 0, sizeof(m_triggered)); // clear() only resets its own bit
+	for (i = 0; i < ALARM_TABLE_SIZE; ++i) { clear(i); }
+}
+
+/*
+ * set
+ *
+ * Copies an alarm (including its current repeat and trigger state) into the table.
+ * Fails for repeat counts that do not fit the table's one byte counters, and
+ * for alarms with more than one match per interval (see Alarm::add_match).
+ */
+bool AlarmTable::set(int index, Alarm const * alarm)
+{
+	if ((index < 0) || (index >= ALARM_TABLE_SIZE)) { return false; }
+	if (!alarm) { return false; }
+	if ((alarm->m_alarm_interval_count < 1) || (alarm->m_alarm_interval_count > 255)) { return false; }
+	if (alarm->m_extra_matches) { return false; } // One value per field only
+
+	TM const * datetime = &alarm->m_datetime;
+
+	m_minute[index] = datetime->tm_min;
+	m_hour[index] = FIELD_ANY;
+	m_mday[index] = FIELD_ANY;
+	m_month[index] = FIELD_ANY;
+	m_wday[index] = FIELD_ANY;
+
+	// Only the fields compared by Alarm::set_current_time for this interval
+	switch (alarm->m_alarm_interval_period)
+	{
+	case INTERVAL_YEAR:
+		m_month[index] = datetime->tm_mon;
+		// Deliberate fall-through!
+	case INTERVAL_MONTH:
+		m_mday[index] = datetime->tm_mday;
+		// Deliberate fall-through!
+	case INTERVAL_DAY:
+		m_hour[index] = datetime->tm_hour;
+		// Deliberate fall-through!
+	case INTERVAL_HOUR:
+		break;
+	case INTERVAL_WEEK:
+		m_wday[index] = datetime->tm_wday;
+		m_hour[index] = datetime->tm_hour;
+		break;
+	default:
+		clear(index);
+		return false;
+	}
+
+	m_interval[index] = alarm->m_alarm_interval_period;
+	m_interval_count[index] = alarm->m_alarm_interval_count;
+	m_current_trigger_count[index] = alarm->m_current_trigger_count;
+	m_duration[index] = alarm->m_duration;
+	m_deactivate_minute[index] = alarm->m_deactivate_minute;
+
+	if (alarm->m_triggered)
+	{
+		m_triggered[BLOCK(index)] |= BIT(index);
+	}
+	else
+	{
+		m_triggered[BLOCK(index)] &= ~BIT(index);
+	}
+
+	return true;
+}
+
+void AlarmTable::clear(int index)
+{
+	if ((index < 0) || (index >= ALARM_TABLE_SIZE)) { return; }
+
+	m_minute[index] = FIELD_UNUSED;
+	m_hour[index] = FIELD_UNUSED;
+	m_mday[index] = FIELD_UNUSED;
+	m_month[index] = FIELD_UNUSED;
+	m_wday[index] = FIELD_UNUSED;
+	m_interval[index] = 0;
+	m_interval_count[index] = 0;
+	m_current_trigger_count[index] = 0;
+	m_duration[index] = 0;
+	m_deactivate_minute[index] = 0;
+	m_triggered[BLOCK(index)] &= ~BIT(index);
+}
+
+bool AlarmTable::is_triggered(int index) const
+{
+	if ((index < 0) || (index >= ALARM_TABLE_SIZE)) { return false; }
+	return (m_triggered[BLOCK(index)] & BIT(index)) != 0;
+}
+
+void AlarmTable::deactivate(int index)
+{
+	if ((index < 0) || (index >= ALARM_TABLE_SIZE)) { return; }
+	m_triggered[BLOCK(index)] &= ~BIT(index);
+}
+
+/*
+ * match_block
+ *
+ * Returns a bitmask of which of the 32 alarms in the block have fields matching
+ * the given time (the times_match calculation in Alarm::set_current_time).
+ */
+uint32_t AlarmTable::match_block(int block, TM const * const time) const
+{
+	int base = block * ALARM_TABLE_BLOCK;
+
+#if defined(ALARM_TABLE_AVX2)
+
+	__m256i match = field_matches(&m_minute[base], time->tm_min);
+	match = _mm256_and_si256(match, field_matches(&m_hour[base], time->tm_hour));
+	match = _mm256_and_si256(match, field_matches(&m_mday[base], time->tm_mday));
+	match = _mm256_and_si256(match, field_matches(&m_month[base], time->tm_mon));
+	match = _mm256_and_si256(match, field_matches(&m_wday[base], time->tm_wday));
+
+	return (uint32_t)_mm256_movemask_epi8(match);
+
+#elif defined(ALARM_TABLE_SSE2)
+
+	uint32_t result = 0;
+	int half;
+
+	for (half = 0; half < 2; ++half)
+	{
+		int i = base + (half * 16);
+		__m128i match = field_matches(&m_minute[i], time->tm_min);
+		match = _mm_and_si128(match, field_matches(&m_hour[i], time->tm_hour));
+		match = _mm_and_si128(match, field_matches(&m_mday[i], time->tm_mday));
+		match = _mm_and_si128(match, field_matches(&m_month[i], time->tm_mon));
+		match = _mm_and_si128(match, field_matches(&m_wday[i], time->tm_wday));
+		result |= (uint32_t)_mm_movemask_epi8(match) << (half * 16);
+	}
+
+	return result;
+
+#else
+
+	uint32_t result = 0;
+	int i;
+
+	for (i = 0; i < ALARM_TABLE_BLOCK; ++i)
+	{
+		bool match = field_matches(m_minute[base + i], time->tm_min);
+		match &= field_matches(m_hour[base + i], time->tm_hour);
+		match &= field_matches(m_mday[base + i], time->tm_mday);
+		match &= field_matches(m_month[base + i], time->tm_mon);
+		match &= field_matches(m_wday[base + i], time->tm_wday);
+		result |= (uint32_t)match << i;
+	}
+
+	return result;
+
+#endif
+}
+
+/*
+ * set_current_time
+ *
+ * Equivalent to Alarm::set_current_time for every alarm in the table. Only alarms
+ * that matched or are already triggered are visited individually.
+ */
+void AlarmTable::set_current_time(TM const * const current_time)
+{
+	if (!current_time) { return; }
+
+	ALARM_MINUTE current_minute = alarm_time_to_minute(current_time);
+	int block;
+
+	for (block = 0; block < ALARM_TABLE_BLOCKS; ++block)
+	{
+		uint32_t triggered = m_triggered[block];
+		uint32_t counting = match_block(block, current_time) & ~triggered;
+		uint32_t still_triggered = 0;
+		int base = block * ALARM_TABLE_BLOCK;
+
+		// Triggered alarms only check their duration
+		while (triggered)
+		{
+			int bit = __builtin_ctzl(triggered);
+			triggered &= triggered - 1;
+
+			if (current_minute <= m_deactivate_minute[base + bit])
+			{
+				still_triggered |= (1UL << bit);
+			}
+		}
+
+		// Untriggered alarms that match count towards their repeat
+		while (counting)
+		{
+			int bit = __builtin_ctzl(counting);
+			int index = base + bit;
+			counting &= counting - 1;
+
+			if (++m_current_trigger_count[index] == m_interval_count[index])
+			{
+				m_current_trigger_count[index] = 0;
+				m_deactivate_minute[index] = current_minute + m_duration[index];
+				still_triggered |= (1UL << bit);
+			}
+		}
+
+		m_triggered[block] = still_triggered;
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef _ALARM_TABLE_H_
+#define _ALARM_TABLE_H_
+
+/*
+ * Defines and typedefs
+ */
+
+// Must be a multiple of ALARM_TABLE_BLOCK
+#ifndef ALARM_TABLE_SIZE
+#define ALARM_TABLE_SIZE (64)
+#endif
+
+#define ALARM_TABLE_BLOCK (32)
+#define ALARM_TABLE_BLOCKS (ALARM_TABLE_SIZE / ALARM_TABLE_BLOCK)
+
+/*
+ * AlarmTable
+ *
+ * Holds alarms as a structure of arrays, one byte per field per alarm, so that a
+ * tick compares the same field of 32 alarms at once (AVX2, SSE2 or a scalar fallback).
+ * Fields an interval does not compare are stored as wildcards.
+ * Results are identical to calling Alarm::set_current_time on each alarm.
+ */
+
+class AlarmTable
+{
+public:
+	AlarmTable();
+
+	bool set(int index, Alarm const * alarm);
+	void clear(int index);
+
+	void set_current_time(TM const * const time);
+
+	bool is_triggered(int index) const;
+	void deactivate(int index);
+
+	uint32_t triggered_block(int block) const { return m_triggered[block]; }
+
+private:
+	uint32_t match_block(int block, TM const * const time) const;
+
+	uint8_t m_minute[ALARM_TABLE_SIZE];
+	uint8_t m_hour[ALARM_TABLE_SIZE];
+	uint8_t m_mday[ALARM_TABLE_SIZE];
+	uint8_t m_month[ALARM_TABLE_SIZE];
+	uint8_t m_wday[ALARM_TABLE_SIZE];
+	uint8_t m_interval[ALARM_TABLE_SIZE];
+	uint8_t m_interval_count[ALARM_TABLE_SIZE];
+	uint8_t m_current_trigger_count[ALARM_TABLE_SIZE];
+
+	uint32_t m_duration[ALARM_TABLE_SIZE];
+	ALARM_MINUTE m_deactivate_minute[ALARM_TABLE_SIZE];
+
+	uint32_t m_triggered[ALARM_TABLE_BLOCKS]; // One bit per alarm
+};
+
+#endif
@@ -0,0 +1,308 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef TEST
+#include <cppunit/TestAssert.h>
+#endif
+
+/*
+ * Code Library Includes
+ */
+
+#include "Utility/util_time.h"
+
+/*
+ * Application Includes
+ */
+
+#include "alarm.h"
+#include "alarm_wheel.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define SECONDS_PER_MINUTE (60UL)
+
+/*
+ * Private Functions
+ */
+
+static void list_init(ALARM_WHEEL_LINK * head)
+{
+	head->next = head;
+	head->prev = head;
+}
+
+static bool list_empty(ALARM_WHEEL_LINK const * head)
+{
+	return head->next == head;
+}
+
+static void list_push(ALARM_WHEEL_LINK * head, ALARM_WHEEL_LINK * link)
+{
+	link->next = head->next;
+	link->prev = head;
+	head->next->prev = link;
+	head->next = link;
+}
+
+static void list_unlink(ALARM_WHEEL_LINK * link)
+{
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	link->next = link;
+	link->prev = link;
+}
+
+/*
+ * AlarmWheel Class
+ */
+
+AlarmWheel::AlarmWheel(UNIX_TIMESTAMP now)
+{
+	int i;
+
+	for (i = 0; i < 60; ++i) { list_init(&m_minutes[i]); }
+	for (i = 0; i < 24; ++i) { list_init(&m_hours[i]); }
+	for (i = 0; i < 31; ++i) { list_init(&m_days[i]); }
+	for (i = 0; i < 12; ++i) { list_init(&m_months[i]); }
+	list_init(&m_overflow);
+
+	for (i = 0; i < WHEEL_LEVELS; ++i) { m_level_count[i] = 0; }
+
+	m_now = now - (now % SECONDS_PER_MINUTE);
+	seconds_to_alarm_time(m_now, &m_now_tm);
+}
+
+/*
+ * add
+ *
+ * Schedules an alarm from the wheel's current time. O(1).
+ */
+void AlarmWheel::add(ALARM_WHEEL_NODE * node, Alarm * alarm)
+{
+	if (!node || !alarm) { return; }
+
+	node->alarm = alarm;
+	node->was_triggered = alarm->is_triggered();
+	node->deadline = alarm->next_deadline(m_now);
+	place(node);
+}
+
+void AlarmWheel::remove(ALARM_WHEEL_NODE * node)
+{
+	if (!node) { return; }
+
+	m_level_count[node->level]--;
+	list_unlink(&node->link);
+}
+
+/*
+ * rearm
+ *
+ * Reschedules an alarm after it has been changed by the application
+ * (e.g. deactivated early, or replaced with a new setting).
+ */
+void AlarmWheel::rearm(ALARM_WHEEL_NODE * node)
+{
+	if (!node) { return; }
+
+	remove(node);
+	add(node, node->alarm);
+}
+
+int AlarmWheel::count() const
+{
+	int total = 0;
+	int i;
+	for (i = 0; i < WHEEL_LEVELS; ++i) { total += m_level_count[i]; }
+	return total;
+}
+
+/*
+ * advance
+ *
+ * Processes every minute up to and including "now", writing each alarm whose
+ * is_triggered() state changed into "due". If more than max_due alarms change,
+ * the wheel stops early and the remainder are returned by the next call.
+ * Returns the number of alarms written.
+ */
+int AlarmWheel::advance(UNIX_TIMESTAMP now, Alarm ** due, int max_due)
+{
+	int n = 0;
+	UNIX_TIMESTAMP target = now - (now % SECONDS_PER_MINUTE);
+
+	if (!due) { return 0; }
+
+	while (m_now <= target)
+	{
+		ALARM_WHEEL_LINK * bucket = &m_minutes[m_now_tm.tm_min];
+
+		// Alarms re-placed into this bucket are due again in this minute, so keep going until it is empty
+		while (!list_empty(bucket))
+		{
+			if (n >= max_due) { return n; }
+
+			ALARM_WHEEL_NODE * node = (ALARM_WHEEL_NODE *)bucket->next;
+			remove(node);
+
+			if (node->alarm->process_deadline(node->deadline, node->was_triggered, &node->deadline))
+			{
+				due[n++] = node->alarm;
+			}
+
+			node->was_triggered = node->alarm->is_triggered();
+			place(node);
+		}
+
+		step(target);
+	}
+
+	return n;
+}
+
+/*
+ * place
+ *
+ * Puts a node in the bucket of the finest wheel that contains its deadline.
+ * Overdue nodes go in the bucket for the current minute.
+ */
+void AlarmWheel::place(ALARM_WHEEL_NODE * node)
+{
+	TM deadline;
+	ALARM_WHEEL_LINK * bucket;
+
+	if (node->deadline == ALARM_NEVER)
+	{
+		node->level = WHEEL_OVERFLOW;
+		bucket = &m_overflow;
+	}
+	else if (node->deadline <= m_now)
+	{
+		node->level = WHEEL_MINUTE;
+		bucket = &m_minutes[m_now_tm.tm_min];
+	}
+	else
+	{
+		seconds_to_alarm_time(node->deadline, &deadline);
+
+		if (deadline.tm_year != m_now_tm.tm_year)
+		{
+			node->level = WHEEL_OVERFLOW;
+			bucket = &m_overflow;
+		}
+		else if (deadline.tm_mon != m_now_tm.tm_mon)
+		{
+			node->level = WHEEL_MONTH;
+			bucket = &m_months[deadline.tm_mon];
+		}
+		else if (deadline.tm_mday != m_now_tm.tm_mday)
+		{
+			node->level = WHEEL_DAY;
+			bucket = &m_days[deadline.tm_mday - 1];
+		}
+		else if (deadline.tm_hour != m_now_tm.tm_hour)
+		{
+			node->level = WHEEL_HOUR;
+			bucket = &m_hours[deadline.tm_hour];
+		}
+		else
+		{
+			node->level = WHEEL_MINUTE;
+			bucket = &m_minutes[deadline.tm_min];
+		}
+	}
+
+	m_level_count[node->level]++;
+	list_push(bucket, &node->link);
+}
+
+void AlarmWheel::cascade(ALARM_WHEEL_LINK * bucket)
+{
+	// Detach the bucket first, as overflow nodes may be placed straight back into it
+	ALARM_WHEEL_LINK pending;
+	list_init(&pending);
+
+	if (!list_empty(bucket))
+	{
+		pending.next = bucket->next;
+		pending.prev = bucket->prev;
+		pending.next->prev = &pending;
+		pending.prev->next = &pending;
+		list_init(bucket);
+	}
+
+	while (!list_empty(&pending))
+	{
+		ALARM_WHEEL_NODE * node = (ALARM_WHEEL_NODE *)pending.next;
+		list_unlink(&node->link);
+		m_level_count[node->level]--;
+		place(node);
+	}
+}
+
+/*
+ * step
+ *
+ * Moves the wheel on by one minute, or straight to the next boundary of the
+ * coarsest wheel that still has alarms in it (but not beyond target), then
+ * cascades the buckets for whichever hour/day/month/year has just begun.
+ */
+void AlarmWheel::step(UNIX_TIMESTAMP target)
+{
+	UNIX_TIMESTAMP next = m_now + SECONDS_PER_MINUTE;
+
+	if (m_level_count[WHEEL_MINUTE] == 0)
+	{
+		TM boundary = m_now_tm;
+		boundary.tm_sec = 0;
+		boundary.tm_min = 0;
+		boundary.tm_hour++;
+
+		if (m_level_count[WHEEL_HOUR] == 0)
+		{
+			boundary.tm_hour = 0;
+			boundary.tm_mday++;
+
+			if (m_level_count[WHEEL_DAY] == 0)
+			{
+				boundary.tm_mday = 1;
+				boundary.tm_mon++;
+
+				if (m_level_count[WHEEL_MONTH] == 0)
+				{
+					boundary.tm_mon = 0;
+					boundary.tm_year++;
+				}
+			}
+		}
+
+		// alarm_time_to_seconds handles the carries (e.g. hour 24, day 32, month 12)
+		next = alarm_time_to_seconds(&boundary);
+		if (next > target + SECONDS_PER_MINUTE) { next = target + SECONDS_PER_MINUTE; }
+	}
+
+	m_now = next;
+	seconds_to_alarm_time(m_now, &m_now_tm);
+
+	if (m_now_tm.tm_min != 0) { return; }
+
+	if (m_now_tm.tm_hour == 0)
+	{
+		if (m_now_tm.tm_mday == 1)
+		{
+			if (m_now_tm.tm_mon == JAN)
+			{
+				cascade(&m_overflow);
+			}
+			cascade(&m_months[m_now_tm.tm_mon]);
+		}
+		cascade(&m_days[m_now_tm.tm_mday - 1]);
+	}
+	cascade(&m_hours[m_now_tm.tm_hour]);
+}
@@ -0,0 +1,78 @@
+#ifndef _ALARM_WHEEL_H_
+#define _ALARM_WHEEL_H_
+
+/*
+ * Defines and typedefs
+ */
+
+enum alarm_wheel_level
+{
+	WHEEL_MINUTE,
+	WHEEL_HOUR,
+	WHEEL_DAY,
+	WHEEL_MONTH,
+	WHEEL_OVERFLOW,
+	WHEEL_LEVELS
+};
+typedef enum alarm_wheel_level ALARM_WHEEL_LEVEL;
+
+struct alarm_wheel_link
+{
+	struct alarm_wheel_link * next;
+	struct alarm_wheel_link * prev;
+};
+typedef struct alarm_wheel_link ALARM_WHEEL_LINK;
+
+// One node per alarm, allocated by the application. link must be the first member.
+struct alarm_wheel_node
+{
+	ALARM_WHEEL_LINK link;
+	Alarm * alarm;
+	UNIX_TIMESTAMP deadline;
+	bool was_triggered; // Alarm state when deadline was calculated
+	ALARM_WHEEL_LEVEL level;
+};
+typedef struct alarm_wheel_node ALARM_WHEEL_NODE;
+
+/*
+ * AlarmWheel
+ *
+ * Hierarchical timing wheel following the calendar: minutes of the current hour,
+ * hours of the current day, days of the current month and months of the current
+ * year, with an overflow list beyond that. Adding and expiring an alarm is O(1)
+ * however many alarms share its deadline. As each hour/day/month/year begins, its
+ * bucket is cascaded down into the finer wheels.
+ */
+
+class AlarmWheel
+{
+public:
+	AlarmWheel(UNIX_TIMESTAMP now);
+
+	void add(ALARM_WHEEL_NODE * node, Alarm * alarm);
+	void remove(ALARM_WHEEL_NODE * node);
+	void rearm(ALARM_WHEEL_NODE * node);
+
+	int advance(UNIX_TIMESTAMP now, Alarm ** due, int max_due);
+
+	UNIX_TIMESTAMP current_time() const { return m_now; }
+	int count() const;
+
+private:
+	void place(ALARM_WHEEL_NODE * node);
+	void cascade(ALARM_WHEEL_LINK * bucket);
+	void step(UNIX_TIMESTAMP target);
+
+	ALARM_WHEEL_LINK m_minutes[60];
+	ALARM_WHEEL_LINK m_hours[24];
+	ALARM_WHEEL_LINK m_days[31];
+	ALARM_WHEEL_LINK m_months[12];
+	ALARM_WHEEL_LINK m_overflow;
+
+	int m_level_count[WHEEL_LEVELS];
+
+	UNIX_TIMESTAMP m_now; // Start of the next minute to be processed
+	TM m_now_tm;
+};
+
+#endif
@@ -23,7 +23,18 @@
  * Defines and Typedefs
  */
 
-#define MAX_NODE_NUMBER (128)
+#define MAX_NODE_NUMBER (AST_POOL_SIZE)
+
+#ifndef MAX_SHARED_NODE_NUMBER
+#define MAX_SHARED_NODE_NUMBER (128)
+#endif
+
+#if MAX_SHARED_NODE_NUMBER > 254 // Leaves room for NO_SHARED_NODE
+#error "Shared node indices must fit a byte"
+#endif
+
+#define SHARED_HASH_SIZE (MAX_SHARED_NODE_NUMBER * 2)
+#define NO_SHARED_NODE (0xFF)
 
 /*
  * Private Variables
@@ -31,6 +42,16 @@
 static ASTNode s_freeNodes[MAX_NODE_NUMBER];
 static uint8_t s_freeNodeIndex = 0;
 
+// Hash-consed store: every distinct subtree of every shared expression, once
+static ASTNode s_sharedNodes[MAX_SHARED_NODE_NUMBER];
+static uint8_t s_sharedNodeCount = 0;
+static uint8_t s_sharedHash[SHARED_HASH_SIZE]; // Node index + 1, or 0 if empty
+
+// Per-tick memo of shared node values, valid where the stamp equals s_tick
+static uint8_t s_memoTick[MAX_SHARED_NODE_NUMBER];
+static bool s_memoValue[MAX_SHARED_NODE_NUMBER];
+static uint8_t s_tick = 1;
+
 /*
  * getNextFreeNode
  * Returns the next free node from the pool
@@ -46,8 +67,7 @@ static ASTNode* getNextFreeNode(Parser * parser)
     }
     else
     {
-        parser->m_success = false;
-        sprintf(parser->m_errorMessage, "Maximum number of nodes (%d) exceeded", MAX_NODE_NUMBER);
+        LEP_SetError(parser, LEP_ERROR_NODE_POOL_FULL, parser->m_Index, MAX_NODE_NUMBER);
         return NULL;
     }
 }
@@ -61,6 +81,264 @@ void AST_Init(void)
     s_freeNodeIndex = 0;
 }
 
+/*
+ * AST_InitArena
+ * Prepares caller-provided node storage for use with LEP_Parse
+ */
+void AST_InitArena(ASTArena * arena, ASTNode * nodes, uint8_t capacity)
+{
+    if (!arena) { return; }
+
+    arena->Nodes = nodes;
+    arena->Capacity = nodes ? capacity : 0;
+    arena->Count = 0;
+}
+
+/*
+ * AST_InitCompactArena
+ * Prepares caller-provided compact node storage for use with LEP_ParseCompact
+ */
+void AST_InitCompactArena(CompactArena * arena, CompactNode * nodes, uint16_t capacity)
+{
+    if (!arena) { return; }
+
+    arena->Nodes = nodes;
+    arena->Capacity = nodes ? ((capacity < LEP_NO_NODE) ? capacity : LEP_NO_NODE) : 0;
+    arena->Count = 0;
+}
+
+/*
+ * AST_PoolNode
+ * Returns the pool node at index (NULL for LEP_NO_NODE), for the parser's index-based core
+ */
+ASTNode* AST_PoolNode(uint16_t index)
+{
+    return (index == LEP_NO_NODE) ? NULL : &s_freeNodes[index];
+}
+
+/*
+ * AST_PoolIndex
+ * Returns the index of a pool node (LEP_NO_NODE for NULL)
+ */
+uint16_t AST_PoolIndex(ASTNode const * node)
+{
+    return node ? (uint16_t)(node - s_freeNodes) : LEP_NO_NODE;
+}
+
+/*
+ * AST_CountNodes
+ * Returns the number of nodes in the tree below (and including) root
+ */
+uint8_t AST_CountNodes(ASTNode const * root)
+{
+    uint8_t count = 1;
+    uint8_t i;
+
+    if (!root) { return 0; }
+
+    if (root->Count)
+    {
+        for (i = 0; i < root->Count; ++i) { count += AST_CountNodes(&root->Left[i]); }
+        return count;
+    }
+
+    return count + AST_CountNodes(root->Left) + AST_CountNodes(root->Right);
+}
+
+/*
+ * copyNode
+ * Copies the tree below node into the arena in pre-order, returning the copy
+ */
+static ASTNode* copyNode(ASTNode const * node, ASTArena * arena)
+{
+    if (!node) { return NULL; }
+
+    ASTNode* copy = &arena->Nodes[arena->Count++];
+
+    copy->Type = node->Type;
+    copy->Value = node->Value;
+    copy->Count = 0;
+    copy->Left = copyNode(node->Left, arena);
+    copy->Right = copyNode(node->Right, arena);
+
+    return copy;
+}
+
+/*
+ * AST_Compact
+ * Moves a tree from LEP_Parse out of the shared pool into one contiguous block of the arena,
+ * leaving the pool free for the next parse. If the arena is too small, parsing
+ * fails and arena->Count is set to the number of nodes needed.
+ */
+ASTNode* AST_Compact(Parser * parser, ASTNode * root, ASTArena * arena)
+{
+    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
+
+    uint8_t needed = AST_CountNodes(root);
+
+    if (needed > arena->Capacity)
+    {
+        arena->Count = needed;
+        LEP_SetError(parser, LEP_ERROR_ARENA_TOO_SMALL, parser->m_Index, needed);
+        return NULL;
+    }
+
+    arena->Count = 0;
+    return copyNode(root, arena);
+}
+
+/*
+ * sharedIndex
+ * Returns the index of a node in the shared store, or NO_SHARED_NODE
+ */
+static uint8_t sharedIndex(ASTNode const * node)
+{
+    if ((node < s_sharedNodes) || (node >= &s_sharedNodes[s_sharedNodeCount])) { return NO_SHARED_NODE; }
+
+    return (uint8_t)(node - s_sharedNodes);
+}
+
+/*
+ * createShared
+ * Returns the shared node with this content, creating it only if there is none.
+ * The children must already be shared, so comparing them by address is enough.
+ */
+static ASTNode* createShared(Parser * parser, ASTNodeType type, uint8_t value, ASTNode* left, ASTNode* right)
+{
+    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
+
+    uint16_t slot = ((uint16_t)type * 251U + value * 31U + sharedIndex(left) * 7U + sharedIndex(right)) % SHARED_HASH_SIZE;
+    uint8_t index;
+
+    while (s_sharedHash[slot])
+    {
+        ASTNode* node = &s_sharedNodes[s_sharedHash[slot] - 1];
+        if ((node->Type == type) && (node->Value == value) && (node->Left == left) && (node->Right == right)) { return node; }
+        slot = (slot + 1) % SHARED_HASH_SIZE;
+    }
+
+    if (s_sharedNodeCount == MAX_SHARED_NODE_NUMBER)
+    {
+        LEP_SetError(parser, LEP_ERROR_SHARED_POOL_FULL, parser->m_Index, MAX_SHARED_NODE_NUMBER);
+        return NULL;
+    }
+
+    index = s_sharedNodeCount++;
+    ASTNode* node = &s_sharedNodes[index];
+    node->Type = type;
+    node->Value = value;
+    node->Count = 0;
+    node->Left = left;
+    node->Right = right;
+    s_memoTick[index] = 0;
+    s_sharedHash[slot] = index + 1;
+
+    return node;
+}
+
+/*
+ * shareNode
+ * Bottom-up copy of a binary tree into the shared store
+ */
+static ASTNode* shareNode(Parser * parser, ASTNode const * node)
+{
+    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
+
+    if (!node) { return NULL; }
+
+    if (node->Count)
+    {
+        LEP_SetError(parser, LEP_ERROR_NOT_SHAREABLE, parser->m_Index, 0);
+        return NULL;
+    }
+
+    bool leaf = (node->Type == FunctionID) || (node->Type == BoolValue);
+    ASTNode* left = shareNode(parser, node->Left);
+    ASTNode* right = shareNode(parser, node->Right);
+
+    return createShared(parser, node->Type, leaf ? node->Value : 0, left, right);
+}
+
+/*
+ * AST_Share
+ * Moves a binary tree into the hash-consed store, where every structurally
+ * identical subtree of every shared expression is stored once. Returns the
+ * shared root, which stays valid until AST_ClearShared. If the store fills,
+ * parsing fails; nodes already added remain valid.
+ */
+ASTNode* AST_Share(Parser * parser, ASTNode const * root)
+{
+    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
+
+    return shareNode(parser, root);
+}
+
+/*
+ * AST_ClearShared
+ * Empties the shared store, invalidating every shared tree
+ */
+void AST_ClearShared(void)
+{
+    s_sharedNodeCount = 0;
+    memset(s_sharedHash, 0, sizeof(s_sharedHash));
+}
+
+uint8_t AST_SharedCount(void)
+{
+    return s_sharedNodeCount;
+}
+
+/*
+ * AST_NextTick
+ * Forgets all memoised values (see AST_GetMemo)
+ */
+void AST_NextTick(void)
+{
+    if (++s_tick == 0)
+    {
+        // Stamps from 256 ticks ago would look current again
+        memset(s_memoTick, 0, sizeof(s_memoTick));
+        s_tick = 1;
+    }
+}
+
+/*
+ * AST_IsShared
+ * True if node is in the shared store (and so must not be modified)
+ */
+bool AST_IsShared(ASTNode const * node)
+{
+    return sharedIndex(node) != NO_SHARED_NODE;
+}
+
+/*
+ * AST_GetMemo
+ * If node is shared and its value has been memoised this tick, returns true and the value
+ */
+bool AST_GetMemo(ASTNode const * node, bool * value)
+{
+    uint8_t index = sharedIndex(node);
+
+    if ((index == NO_SHARED_NODE) || (s_memoTick[index] != s_tick)) { return false; }
+
+    *value = s_memoValue[index];
+    return true;
+}
+
+/*
+ * AST_SetMemo
+ * Records the value of a shared node for the rest of this tick (ignored for other nodes)
+ */
+void AST_SetMemo(ASTNode const * node, bool value)
+{
+    uint8_t index = sharedIndex(node);
+
+    if (index == NO_SHARED_NODE) { return; }
+
+    s_memoTick[index] = s_tick;
+    s_memoValue[index] = value;
+}
+
 /*
  * AST_CreateNode
  * Creates a AND or OR node with the provided left and right nodes
@@ -75,6 +353,7 @@ ASTNode* AST_CreateNode(Parser * parser, ASTNodeType type, ASTNode* left, ASTNod
     if (node)
     {
         node->Type = type;
+        node->Count = 0;
         node->Left = left;
         node->Right = right;
         DEBUG( printf("%s (%s)\n", __func__, type == OperatorOr ? "or" : "and") );
@@ -97,6 +376,7 @@ ASTNode* AST_CreateUnaryNode(Parser * parser, ASTNode* child)
     if (node)
     {
         node->Type = UnaryNot;
+        node->Count = 0;
         node->Left = child;
         node->Right = NULL;
         
@@ -121,6 +401,9 @@ ASTNode* AST_CreateNodeBoolFunction(Parser * parser, uint8_t value)
     {
         node->Type = FunctionID;
         node->Value = value;
+        node->Count = 0;
+        node->Left = NULL;
+        node->Right = NULL;
         
         DEBUG( printf("%s (%d)\n", __func__, value) );
     }
@@ -141,8 +424,11 @@ ASTNode* AST_CreateNodeBoolValue(Parser * parser, bool value)
 
     if (node)
     {
-        node->Type = FunctionID;
+        node->Type = BoolValue;
         node->Value = value;
+        node->Count = 0;
+        node->Left = NULL;
+        node->Right = NULL;
 
         DEBUG( printf("%s (%s)\n", __func__, value ? "true" : "false") );
     }
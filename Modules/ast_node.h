@@ -3,11 +3,30 @@
 
 #include "parser_types.h"
 
+/*
+ * Defines and Typedefs
+ */
+
+#define AST_POOL_SIZE (128) // Nodes shared by every LEP_Parse without an arena
+
 /*
  * Public Function Declarations
  */
 
 void AST_Init(void);
+void AST_InitArena(ASTArena * arena, ASTNode * nodes, uint8_t capacity);
+void AST_InitCompactArena(CompactArena * arena, CompactNode * nodes, uint16_t capacity);
+ASTNode* AST_PoolNode(uint16_t index);
+uint16_t AST_PoolIndex(ASTNode const * node);
+uint8_t AST_CountNodes(ASTNode const * root);
+ASTNode* AST_Compact(Parser * parser, ASTNode * root, ASTArena * arena);
+ASTNode* AST_Share(Parser * parser, ASTNode const * root);
+void AST_ClearShared(void);
+uint8_t AST_SharedCount(void);
+bool AST_IsShared(ASTNode const * node);
+void AST_NextTick(void);
+bool AST_GetMemo(ASTNode const * node, bool * value);
+void AST_SetMemo(ASTNode const * node, bool value);
 ASTNode* AST_CreateNode(Parser * parser, ASTNodeType type, ASTNode* left, ASTNode* right);
 ASTNode* AST_CreateUnaryNode(Parser * parser, ASTNode* child);
 ASTNode* AST_CreateNodeBoolValue(Parser * parser, bool value);
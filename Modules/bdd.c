@@ -0,0 +1,259 @@
+/* bdd.c
+ * Converts abstract syntax trees into shared, reduced ordered binary decision diagrams
+ */
+
+/*
+ * C Library Includes
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/*
+ * Local Module Includes
+ */
+
+#include "syntax_parser.h"
+#include "bdd.h"
+
+/*
+ * Local Application Includes
+ */
+
+#include "app.config.h"
+
+/*
+ * Defines and Typedefs
+ */
+
+#ifndef BDD_UNIQUE_SIZE
+#define BDD_UNIQUE_SIZE (BDD_MAX_NODES * 2) // Open addressing: keep well above BDD_MAX_NODES
+#endif
+
+#ifndef BDD_CACHE_SIZE
+#define BDD_CACHE_SIZE (128)
+#endif
+
+#define BDD_MAX_VARS (NUMBER_OF_IO + NUMBER_OF_ALARMS)
+#define TERMINAL_LEVEL (0xFF)
+#define NO_LEVEL (0xFF)
+
+#if BDD_MAX_NODES > 0xFFFE
+#error "BDD_MAX_NODES must leave room for BDD_INVALID"
+#endif
+
+#if BDD_MAX_VARS >= TERMINAL_LEVEL
+#error "Too many function IDs for one byte BDD levels"
+#endif
+
+struct bddnode
+{
+    uint8_t Level; // Position of the variable in the order
+    BDDREF  Low;   // Variable false
+    BDDREF  High;  // Variable true
+};
+typedef struct bddnode BDDNode;
+
+struct bddcacheentry
+{
+    BDDREF F;
+    BDDREF G;
+    BDDREF H;
+    BDDREF Result;
+};
+typedef struct bddcacheentry BDDCacheEntry;
+
+/*
+ * Private Variables
+ */
+
+static BDDNode s_nodes[BDD_MAX_NODES];
+static uint16_t s_nodeCount = 0;
+
+static BDDREF s_unique[BDD_UNIQUE_SIZE]; // 0 (a terminal) marks an empty slot
+static BDDCacheEntry s_cache[BDD_CACHE_SIZE];
+
+static uint8_t s_order[BDD_MAX_VARS]; // Function ID at each level
+static uint8_t s_level[BDD_MAX_VARS]; // Level of each function ID
+static uint8_t s_varCount = 0;
+
+/*
+ * Private Functions
+ */
+
+/* makeNode
+ * Find or create the node for (level, low, high), keeping the diagram reduced
+ */
+static BDDREF makeNode(uint8_t level, BDDREF low, BDDREF high)
+{
+    uint16_t slot;
+    BDDREF ref;
+
+    if ((low == BDD_INVALID) || (high == BDD_INVALID)) { return BDD_INVALID; }
+    if (low == high) { return low; }
+
+    slot = ((uint32_t)level * 7919UL + (uint32_t)low * 31UL + high) % BDD_UNIQUE_SIZE;
+
+    while ((ref = s_unique[slot]) != 0)
+    {
+        BDDNode const * node = &s_nodes[ref];
+        if ((node->Level == level) && (node->Low == low) && (node->High == high)) { return ref; }
+        slot = (slot + 1) % BDD_UNIQUE_SIZE;
+    }
+
+    if (s_nodeCount == BDD_MAX_NODES) { return BDD_INVALID; }
+
+    ref = s_nodeCount++;
+    s_nodes[ref].Level = level;
+    s_nodes[ref].Low = low;
+    s_nodes[ref].High = high;
+    s_unique[slot] = ref;
+
+    return ref;
+}
+
+/* cofactor
+ * The diagram with the variable at level fixed to value
+ */
+static BDDREF cofactor(BDDREF ref, uint8_t level, bool value)
+{
+    BDDNode const * node = &s_nodes[ref];
+
+    if (node->Level != level) { return ref; }
+
+    return value ? node->High : node->Low;
+}
+
+/* ite
+ * If-then-else: (f & g) | (!f & h), the one operation all others are built from
+ */
+static BDDREF ite(BDDREF f, BDDREF g, BDDREF h)
+{
+    BDDCacheEntry * entry;
+    uint8_t top;
+    BDDREF result;
+
+    if ((f == BDD_INVALID) || (g == BDD_INVALID) || (h == BDD_INVALID)) { return BDD_INVALID; }
+    if (f == BDD_TRUE) { return g; }
+    if (f == BDD_FALSE) { return h; }
+    if (g == h) { return g; }
+    if ((g == BDD_TRUE) && (h == BDD_FALSE)) { return f; }
+
+    entry = &s_cache[((uint32_t)f * 31UL + (uint32_t)g * 17UL + h) % BDD_CACHE_SIZE];
+    if ((entry->F == f) && (entry->G == g) && (entry->H == h)) { return entry->Result; }
+
+    top = s_nodes[f].Level;
+    if (s_nodes[g].Level < top) { top = s_nodes[g].Level; }
+    if (s_nodes[h].Level < top) { top = s_nodes[h].Level; }
+
+    result = makeNode(top,
+        ite(cofactor(f, top, false), cofactor(g, top, false), cofactor(h, top, false)),
+        ite(cofactor(f, top, true), cofactor(g, top, true), cofactor(h, top, true)));
+
+    if (result != BDD_INVALID)
+    {
+        entry->F = f;
+        entry->G = g;
+        entry->H = h;
+        entry->Result = result;
+    }
+
+    return result;
+}
+
+/* variable
+ * The diagram for a single function, placing it last in the order if new
+ */
+static BDDREF variable(uint8_t fid)
+{
+    if (fid >= BDD_MAX_VARS) { return BDD_INVALID; }
+
+    if (s_level[fid] == NO_LEVEL)
+    {
+        s_level[fid] = s_varCount;
+        s_order[s_varCount++] = fid;
+    }
+
+    return makeNode(s_level[fid], BDD_FALSE, BDD_TRUE);
+}
+
+static BDDREF combine(ASTNodeType type, BDDREF a, BDDREF b)
+{
+    return (type == OperatorAnd) ? ite(a, b, BDD_FALSE) : ite(a, BDD_TRUE, b);
+}
+
+/*
+ * Public Functions
+ */
+
+void BDD_Init(void)
+{
+    s_nodes[BDD_FALSE].Level = TERMINAL_LEVEL;
+    s_nodes[BDD_TRUE].Level = TERMINAL_LEVEL;
+    s_nodeCount = 2;
+
+    memset(s_unique, 0, sizeof(s_unique));
+    memset(s_cache, 0, sizeof(s_cache)); // F == 0 never reaches the cache
+    memset(s_level, NO_LEVEL, sizeof(s_level));
+    s_varCount = 0;
+}
+
+/* BDD_FromAST
+ * Convert a binary or optimised n-ary tree. Returns BDD_INVALID if the node
+ * pool runs out; diagrams already built are unaffected.
+ */
+BDDREF BDD_FromAST(ASTNode const * ast)
+{
+    BDDREF result;
+    uint8_t i;
+
+    if (!ast) { return BDD_INVALID; }
+
+    switch(ast->Type)
+    {
+        case FunctionID:
+            return variable(ast->Value);
+        case BoolValue:
+            return ast->Value ? BDD_TRUE : BDD_FALSE;
+        case UnaryNot:
+            return ite(BDD_FromAST(ast->Left), BDD_FALSE, BDD_TRUE);
+        case OperatorAnd:
+        case OperatorOr:
+            if (!ast->Count)
+            {
+                result = BDD_FromAST(ast->Left);
+                return combine(ast->Type, result, BDD_FromAST(ast->Right));
+            }
+            result = BDD_FromAST(&ast->Left[0]);
+            for (i = 1; i < ast->Count; ++i)
+            {
+                result = combine(ast->Type, result, BDD_FromAST(&ast->Left[i]));
+            }
+            return result;
+        default:
+            return BDD_INVALID;
+    }
+}
+
+/* BDD_Evaluate
+ * Follow one path from the root, calling at most one function per variable
+ */
+bool BDD_Evaluate(BDDREF bdd)
+{
+    while ((bdd > BDD_TRUE) && (bdd < s_nodeCount))
+    {
+        BDDNode const * node = &s_nodes[bdd];
+        bdd = LEP_CallFunction(s_order[node->Level]) ? node->High : node->Low;
+    }
+
+    return bdd == BDD_TRUE;
+}
+
+/* BDD_NodesUsed
+ * Nodes taken from the pool, including the two terminals
+ */
+uint16_t BDD_NodesUsed(void)
+{
+    return s_nodeCount;
+}
@@ -0,0 +1,42 @@
+#ifndef _BDD_H_
+#define _BDD_H_
+
+#include "parser_types.h"
+
+/*
+ * Defines and Typedefs
+ */
+
+#ifndef BDD_MAX_NODES
+#define BDD_MAX_NODES (256)
+#endif
+
+#define BDD_FALSE (0)
+#define BDD_TRUE (1)
+#define BDD_INVALID (0xFFFF) // Node pool full or bad input
+
+typedef uint16_t BDDREF;
+
+/*
+ * Reduced ordered binary decision diagrams for LEP expressions.
+ *
+ * All diagrams share one node pool and unique table, so two expressions are
+ * equivalent exactly when their BDDREFs are equal, and an expression is always
+ * true or always false exactly when it is BDD_TRUE or BDD_FALSE.
+ *
+ * Variables (function IDs) are ordered by first appearance in a depth-first walk
+ * of the trees converted, which keeps related functions adjacent. New variables
+ * are always placed after existing ones, so earlier diagrams stay canonical.
+ * Nodes are never freed individually: BDD_Init clears the whole pool.
+ */
+
+/*
+ * Public Function Declarations
+ */
+
+void BDD_Init(void);
+BDDREF BDD_FromAST(ASTNode const * ast);
+bool BDD_Evaluate(BDDREF bdd);
+uint16_t BDD_NodesUsed(void);
+
+#endif
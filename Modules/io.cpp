@@ -23,12 +23,12 @@
  * Public Functions
  */
 
-bool parse_chars_to_io_type(IO_TYPE * io_type, char * chars)
+bool parse_chars_to_io_type(IO_TYPE * io_type, char const * chars, size_t length)
 {
 	if (!io_type || !chars) { return false; }
 
-	if (simple_cmp(3, chars, "OUT")) { *io_type = OUTPUT; return true; }
-	if (simple_cmp(2, chars, "IN")) { *io_type = INPUT; return true; }
+	if ((length >= 3) && simple_cmp(3, chars, "OUT")) { *io_type = OUTPUT; return true; }
+	if ((length >= 2) && simple_cmp(2, chars, "IN")) { *io_type = INPUT; return true; }
 
 	return false;
 }
\ No newline at end of file
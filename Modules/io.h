@@ -16,7 +16,7 @@ enum io_state
 };
 typedef enum io_state IO_STATE;
 
-bool parse_chars_to_io_type(IO_TYPE * io_type, char * chars);
+bool parse_chars_to_io_type(IO_TYPE * io_type, char const * chars, size_t length);
 
 IO_STATE app_get_io_state(int input_to_read);
 
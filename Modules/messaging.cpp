@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
@@ -28,6 +29,7 @@
 #include "app.rtc.h"
 #include "alarm.h"
 #include "messaging.h"
+#include "syntax_parser.h"
 
 /*
  * Local Application Includes
@@ -86,15 +88,16 @@ static int * get_input_index_range()
     return range;
 }
 
-static bool message_is_correct_rtc_format(char * message)
+static bool message_is_correct_rtc_format(MESSAGE_VIEW const * message)
 {
     // Date time format is DDD YY-MM-DD hh:mm:ss
     // This function only validates FORMAT, not content
-    DT_FORMAT_STRING * message_as_time = (DT_FORMAT_STRING * )message;
+    DT_FORMAT_STRING const * message_as_time = (DT_FORMAT_STRING const *)message->data;
 
     bool valid = true;
-    
-    valid &= strlen(message) == sizeof(DT_FORMAT_STRING);
+
+    if (message->length != sizeof(DT_FORMAT_STRING)) { return false; }
+
     valid &= message_as_time->hyphen1 == '-';
     valid &= message_as_time->hyphen2 == '-';
     valid &= message_as_time->space1 == ' ';
@@ -122,11 +125,11 @@ static bool is_valid_interval(char interval)
  * the string given by datetime_str and validate it for
  * sanity. The basic string is mm-dd hh:mm:ss
  * but all values are optional and default to 1st January 00:00 unless string specifies them.
+ * Only the first length characters of datetime_str are read.
  */
-static bool parse_datetime_for_interval(char interval, char const * datetime_str, TM * datetime)
+static bool parse_datetime_for_interval(char interval, char const * datetime_str, int length, TM * datetime)
 {
     bool success = true;
-    int length = strlen(datetime_str);
 
     /* Parse by cascading from year to hour */
     if (interval == INTERVAL_YEAR)
@@ -212,29 +215,48 @@ static bool parse_datetime_for_interval(char interval, char const * datetime_str
  * 0 is returned otherwise.
  */
 
-static int try_get_duration_from_message(char * message)
+static int try_get_duration_from_message(MESSAGE_VIEW const * message)
 {
     int result = 0;
     int multiplier = 1;
 
-    int c = strlen(message) - 1; // Start at end of message
-    while (isdigit(message[c]) && (c >= 0))
+    char const * data = message->data;
+    int c = (int)message->length - 1; // Start at end of message
+    while ((c >= 0) && isdigit(data[c]))
     {
-        result += (message[c] - '0') * multiplier;
+        result += (data[c] - '0') * multiplier;
         multiplier *= 10;
         c--;
     }
 
     if (c < 0) { return 0; } // Ran out of chars to process
 
-    if (message[c] != 'D') { return 0;} // Digits not prefixed with 'D'
+    if (data[c] != 'D') { return 0;} // Digits not prefixed with 'D'
 
     return result;
 }
 
+/*
+ * Dispatch table, indexed by MSG_DISPATCH_IDX(id).
+ * Entries must stay in the same order as the message_id enumeration.
+ */
+
+const MessageHandler::MSG_DISPATCH MessageHandler::s_dispatch[MSG_DISPATCH_COUNT] = {
+    {&MessageHandler::set_rtc_from_message, true}, // MSG_SET_RTC
+    {&MessageHandler::get_rtc, false}, // MSG_GET_RTC
+    {&MessageHandler::set_alarm_from_message, true}, // MSG_SET_ALARM
+    {&MessageHandler::clear_alarm_from_message, true}, // MSG_CLEAR_ALARM
+    {&MessageHandler::set_trigger_from_message, true}, // MSG_SET_TRIGGER
+    {&MessageHandler::clear_trigger_from_message, true}, // MSG_CLEAR_TRIGGER
+    {&MessageHandler::set_io_type_from_message, true}, // MSG_SET_IO_TYPE
+    {&MessageHandler::read_input_from_message, false}, // MSG_READ_INPUT
+    {&MessageHandler::reset_from_message, false} // MSG_RESET
+};
+
 MessageHandler::MessageHandler(MSG_HANDLER_FUNCTIONS * callbacks)
 {
     m_callbacks  = callbacks;
+    m_validate_only = false;
 }
 
 void MessageHandler::new_reply(MESSAGE_ID id)
@@ -248,48 +270,38 @@ bool MessageHandler::handle_message(char * message)
 {
     if (!message) { return false; }
 
-    MESSAGE_ID id = (MESSAGE_ID)message[0];
-    
+    return handle_message(message, strlen(message));
+}
+
+/*
+ * handle_message
+ *
+ * Length-aware entry point: data need not be NUL terminated, and each
+ * handler receives a view of the message body so that it is scanned once.
+ */
+bool MessageHandler::handle_message(char const * data, size_t length)
+{
+    if (!data || !length) { return false; }
+
+    MESSAGE_ID id = (MESSAGE_ID)data[0];
+    MESSAGE_VIEW message = {&data[1], length - 1};
+
     bool result = false;
     
     bool send_standard_reply = true;
 
     if (!m_callbacks) { return false; }
 
-    switch(id)
+    if ((id == MSG_BATCH) || (id == MSG_BATCH_ALL_OR_NOTHING))
     {
-    case MSG_SET_RTC:
-        result = set_rtc_from_message(&message[1]);
-        break;
-    case MSG_GET_RTC:
-        result = get_rtc();
-        send_standard_reply = false;
-        break;
-    case MSG_SET_ALARM:
-        result = set_alarm_from_message(&message[1]);
-        break;
-    case MSG_CLEAR_ALARM:
-        result = clear_alarm_from_message(&message[1]);
-        break;
-    case MSG_SET_TRIGGER:
-        result = set_trigger_from_message(&message[1]);
-        break;
-    case MSG_CLEAR_TRIGGER:
-        result = clear_trigger_from_message(&message[1]);
-        break;
-    case MSG_SET_IO_TYPE:
-        result = set_io_type_from_message(&message[1]);
-        break;
-    case MSG_READ_INPUT:
-        result = read_input_from_message(&message[1]);
-        send_standard_reply = false;
-        break;
-    case MSG_RESET:
-        result = reset_from_message();
-        send_standard_reply = false;
-        break;
-    default:
-        break;
+        return handle_batch(id, &message);
+    }
+
+    if ((id >= MSG_SET_RTC) && (id < _MSG_MAX_ID))
+    {
+        MSG_DISPATCH const * dispatch = &s_dispatch[MSG_DISPATCH_IDX(id)];
+        result = (this->*dispatch->parse_fn)(&message);
+        send_standard_reply = dispatch->send_standard_reply;
     }
 
     if (send_standard_reply)
@@ -303,7 +315,100 @@ bool MessageHandler::handle_message(char * message)
     return result;
 }
 
-bool MessageHandler::set_rtc_from_message(char * message)
+/*
+ * handle_batch
+ *
+ * Runs each command of a batch frame in order and sends a single reply of the form
+ * '>* OK XXXX' or '>* FAIL XXXX', where XXXX is a hex bitmap with bit n set if
+ * command n succeeded.
+ * In all-or-nothing mode every command is first parsed and checked without
+ * calling back (trigger expressions are parsed too), and none are run unless all
+ * of them pass. Callbacks are not rolled back: if one refuses a command that
+ * passed the checks, the commands before it stay applied and the bitmap shows it.
+ */
+bool MessageHandler::handle_batch(MESSAGE_ID id, MESSAGE_VIEW const * frame)
+{
+    uint16_t status = 0; // One bit per command, so at most 16 commands
+    uint16_t all_passed = 0xFFFF;
+    uint8_t count = 1;
+    size_t i;
+
+    for (i = 0; (i < frame->length) && (count <= MSG_BATCH_MAX_COMMANDS); i++)
+    {
+        if (frame->data[i] == MSG_BATCH_SEPARATOR) { count++; }
+    }
+
+    if (count <= MSG_BATCH_MAX_COMMANDS)
+    {
+        if (count < MSG_BATCH_MAX_COMMANDS) { all_passed = (1U << count) - 1; }
+
+        if (id == MSG_BATCH_ALL_OR_NOTHING)
+        {
+            m_validate_only = true;
+            status = run_batch(frame);
+            m_validate_only = false;
+        }
+
+        if ((id == MSG_BATCH) || (status == all_passed))
+        {
+            status = run_batch(frame);
+        }
+    }
+
+    new_reply(id);
+    snprintf(&s_reply[2], MAX_MESSAGE_LENGTH-2, " %s %04X", (status == all_passed) ? "OK" : "FAIL", status);
+    m_callbacks->reply_fn(s_reply);
+
+    return (status == all_passed);
+}
+
+uint16_t MessageHandler::run_batch(MESSAGE_VIEW const * frame)
+{
+    uint16_t status = 0;
+    uint8_t index = 0;
+    char const * command = frame->data;
+    char const * end = frame->data + frame->length;
+    char const * separator;
+
+    while (true)
+    {
+        separator = (char const *)memchr(command, MSG_BATCH_SEPARATOR, end - command);
+        if (!separator) { separator = end; }
+
+        if (run_batch_command(command, separator - command)) { status |= (1U << index); }
+
+        if (separator == end) { break; }
+
+        index++;
+        command = separator + 1;
+    }
+
+    return status;
+}
+
+/*
+ * run_batch_command
+ *
+ * Commands that send their own reply (e.g. get RTC or reset) would break the
+ * single coalesced reply, so they always fail inside a batch.
+ */
+bool MessageHandler::run_batch_command(char const * data, size_t length)
+{
+    if (!length) { return false; }
+
+    MESSAGE_ID id = (MESSAGE_ID)data[0];
+    MESSAGE_VIEW message = {&data[1], length - 1};
+
+    if ((id < MSG_SET_RTC) || (id >= _MSG_MAX_ID)) { return false; }
+
+    MSG_DISPATCH const * dispatch = &s_dispatch[MSG_DISPATCH_IDX(id)];
+
+    if (!dispatch->send_standard_reply) { return false; }
+
+    return (this->*dispatch->parse_fn)(&message);
+}
+
+bool MessageHandler::set_rtc_from_message(MESSAGE_VIEW const * message)
 {
     bool result = false;
 
@@ -314,7 +419,7 @@ bool MessageHandler::set_rtc_from_message(char * message)
     if (!message_is_correct_rtc_format(message)) { return false; }
     
     // Convert each part of the message to integer
-    DT_FORMAT_STRING * message_as_time = (DT_FORMAT_STRING*)message;
+    DT_FORMAT_STRING const * message_as_time = (DT_FORMAT_STRING const *)message->data;
 
     if (!chars_to_weekday(&new_time.tm_wday, message_as_time->day)) { return false; }
     if (!parse_chars_to_int(&new_time.tm_year, message_as_time->year, 2)) { return false; }
@@ -329,14 +434,17 @@ bool MessageHandler::set_rtc_from_message(char * message)
     if (!days_in_month_valid(new_time.tm_mday, new_time.tm_mon, new_time.tm_year)) { return 0; }
 
     // Got this far, everything is valid
+    if (m_validate_only) { return true; }
     result = m_callbacks->set_rtc_fn(&new_time);
     return result;
 }
 
-bool MessageHandler::get_rtc()
+bool MessageHandler::get_rtc(MESSAGE_VIEW const * message)
 {
     bool result = false;
 
+    (void)message;
+
     if (!m_callbacks->reply_fn) { return false; }
 
     TM tm;
@@ -350,20 +458,26 @@ bool MessageHandler::get_rtc()
     return result;
 }
 
-bool MessageHandler::set_alarm_from_message(char * message)
+bool MessageHandler::set_alarm_from_message(MESSAGE_VIEW const * message)
 {
     bool result = false;
     int action_id;
     int repeat = 0;
+    int datetime_length = 0;
     
     TM alarm_time;
     set_default_alarm_time(&alarm_time);
 
     if (!message) { return false; }
     if (!m_callbacks->set_alarm_fn) { return false; }
-    if (strlen(message) == 0) { return false;}
+    if (message->length <= offsetof(SET_ALARM_FORMAT_STRING, interval)) { return false;}
 
-    SET_ALARM_FORMAT_STRING * message_as_set_alarm_string = (SET_ALARM_FORMAT_STRING*)message;
+    SET_ALARM_FORMAT_STRING const * message_as_set_alarm_string = (SET_ALARM_FORMAT_STRING const *)message->data;
+
+    if (message->length > offsetof(SET_ALARM_FORMAT_STRING, datetime_start))
+    {
+        datetime_length = message->length - offsetof(SET_ALARM_FORMAT_STRING, datetime_start);
+    }
 
     if (!parse_chars_to_int(&action_id, message_as_set_alarm_string->action_id, 2, get_alarm_id_range())) { return false; }
     if (!parse_chars_to_int(&repeat, message_as_set_alarm_string->repeat, 2, get_max_repeat())) { return false; }
@@ -373,6 +487,7 @@ bool MessageHandler::set_alarm_from_message(char * message)
     if (!parse_datetime_for_interval(
         message_as_set_alarm_string->interval,
         &message_as_set_alarm_string->datetime_start,
+        datetime_length,
         &alarm_time))
     {
         return false; 
@@ -385,55 +500,67 @@ bool MessageHandler::set_alarm_from_message(char * message)
     Alarm new_alarm = Alarm((INTERVAL)message_as_set_alarm_string->interval, &alarm_time, repeat, duration);
 
     result = new_alarm.valid();
+    if (m_validate_only) { return result; }
     result &= m_callbacks->set_alarm_fn(action_id, &new_alarm);
 
     return result;
 }
 
-bool MessageHandler::clear_alarm_from_message(char * message)
+bool MessageHandler::clear_alarm_from_message(MESSAGE_VIEW const * message)
 {
     bool result = false;
     int action_id;
 
     if (!m_callbacks->clr_alarm_fn) { return false; }
 
-    if (!parse_chars_to_int(&action_id, message, 2, get_alarm_id_range())) { return false; }
+    if (message->length < 2) { return false; }
+    if (!parse_chars_to_int(&action_id, message->data, 2, get_alarm_id_range())) { return false; }
 
+    if (m_validate_only) { return true; }
     result = m_callbacks->clr_alarm_fn(action_id);
 
     return result;
 }
 
-bool MessageHandler::set_trigger_from_message(char * message)
+bool MessageHandler::set_trigger_from_message(MESSAGE_VIEW const * message)
 {
     bool result = false;
     int io_index;
 
     if (!m_callbacks->set_trigger_fn) { return false; }
 
-    if (message[1] != ' ') { return false; }
-    if (!parse_chars_to_int(&io_index, &message[0], 1, get_input_index_range())) { return false; }
-    
-    result = m_callbacks->set_trigger_fn(io_index, &message[2]);
+    if (message->length < 2) { return false; }
+    if (message->data[1] != ' ') { return false; }
+    if (!parse_chars_to_int(&io_index, &message->data[0], 1, get_input_index_range())) { return false; }
+
+    if (m_validate_only)
+    {
+        Parser parser;
+        return LEP_Check(&parser, &message->data[2], message->length - 2);
+    }
+
+    result = m_callbacks->set_trigger_fn(io_index, &message->data[2], message->length - 2);
 
     return result;
 }
 
-bool MessageHandler::clear_trigger_from_message(char * message)
+bool MessageHandler::clear_trigger_from_message(MESSAGE_VIEW const * message)
 {
     bool result = false;
     int io_index;
 
     if (!m_callbacks->clear_trigger_fn) { return false; }
 
-    if (!parse_chars_to_int(&io_index, &message[0], 1, get_input_index_range())) { return false; }
+    if (message->length < 1) { return false; }
+    if (!parse_chars_to_int(&io_index, &message->data[0], 1, get_input_index_range())) { return false; }
 
+    if (m_validate_only) { return true; }
     result = m_callbacks->clear_trigger_fn(io_index);
 
     return result;
 }
 
-bool MessageHandler::set_io_type_from_message(char * message)
+bool MessageHandler::set_io_type_from_message(MESSAGE_VIEW const * message)
 {
     bool result = false;
     int io_index;
@@ -441,25 +568,28 @@ bool MessageHandler::set_io_type_from_message(char * message)
     
     if (!m_callbacks->set_io_type_fn) { return false; }
 
-    if (message[1] != ' ') { return false; }
+    if (message->length < 2) { return false; }
+    if (message->data[1] != ' ') { return false; }
 
-    if (!parse_chars_to_int(&io_index, &message[0], 1, get_input_index_range())) { return false; }
+    if (!parse_chars_to_int(&io_index, &message->data[0], 1, get_input_index_range())) { return false; }
 
-    if (!parse_chars_to_io_type(&io_type, &message[2])) { return false; }
+    if (!parse_chars_to_io_type(&io_type, &message->data[2], message->length - 2)) { return false; }
 
+    if (m_validate_only) { return true; }
     result = m_callbacks->set_io_type_fn(io_index, io_type);
 
     return result;  
 }
 
-bool MessageHandler::read_input_from_message(char * message)
+bool MessageHandler::read_input_from_message(MESSAGE_VIEW const * message)
 {
     bool result = false;
     int io_index = -1;
 
     if (!m_callbacks->reply_fn) { return false; }
 
-    if (!parse_chars_to_int(&io_index, &message[0], 1, get_input_index_range())) { return false; }
+    if (message->length < 1) { return false; }
+    if (!parse_chars_to_int(&io_index, &message->data[0], 1, get_input_index_range())) { return false; }
 
     io_index = one_indexed_to_zero_indexed(io_index);
 
@@ -488,10 +618,12 @@ bool MessageHandler::read_input_from_message(char * message)
     return result;
 }
 
-bool MessageHandler::reset_from_message()
+bool MessageHandler::reset_from_message(MESSAGE_VIEW const * message)
 {
     bool result = false;
 
+    (void)message;
+
     if (!m_callbacks->reset_fn) { return false; }
 
     new_reply(MSG_RESET);
@@ -7,6 +7,10 @@
 
 #define MAX_MESSAGE_LENGTH (32)
 
+// Batch frames carry several commands separated by MSG_BATCH_SEPARATOR
+#define MSG_BATCH_SEPARATOR (';')
+#define MSG_BATCH_MAX_COMMANDS (16)
+
 // Note: these message IDs do not start at 0!
 // This will affect how any loops or arrays using this enumeration are iterated/indexed!
 
@@ -22,6 +26,8 @@ enum message_id
     MSG_READ_INPUT,
     MSG_RESET,
     _MSG_MAX_ID,
+    MSG_BATCH = '*',
+    MSG_BATCH_ALL_OR_NOTHING = '#',
     MSG_REPLY = '>'
 };
 typedef enum message_id MESSAGE_ID;
@@ -29,10 +35,21 @@ typedef enum message_id MESSAGE_ID;
 #define MSG_ID_IDX(id) (id - '0')
 #define MSG_MAX_ID MSG_ID_IDX(_MSG_MAX_ID)
 
+#define MSG_DISPATCH_IDX(id) (id - MSG_SET_RTC)
+#define MSG_DISPATCH_COUNT MSG_DISPATCH_IDX(_MSG_MAX_ID)
+
+// A message body that is not NUL terminated: data is only valid up to length
+struct message_view
+{
+	char const * data;
+	size_t length;
+};
+typedef struct message_view MESSAGE_VIEW;
+
 typedef bool (*MSG_SET_RTC_FN)(TM* tm);
 typedef bool (*MSG_SET_ALARM_FN)(int alarm_id, Alarm * pAlarm);
 typedef bool (*MSG_CLEAR_ALARM_FN)(int alarm_id);
-typedef bool (*MSG_SET_TRIGGER_FN)(int io_index, char * pTriggerExpression);
+typedef bool (*MSG_SET_TRIGGER_FN)(int io_index, char const * pTriggerExpression, size_t length); // Not NUL terminated
 typedef bool (*MSG_CLEAR_TRIGGER_FN)(int io_index);
 typedef bool (*MSG_SET_IO_TYPE_FN)(int io_index, IO_TYPE io_type);
 typedef bool (*MSG_READ_INPUT_FN)(IO_STATE io_state);
@@ -57,22 +74,39 @@ class MessageHandler
 	public:
 		MessageHandler(MSG_HANDLER_FUNCTIONS * callbacks);
 		bool handle_message(char * message);
+		bool handle_message(char const * data, size_t length);
 
 	private:
 
+		typedef bool (MessageHandler::*MSG_PARSE_FN)(MESSAGE_VIEW const * message);
+
+		struct msg_dispatch
+		{
+			MSG_PARSE_FN parse_fn;
+			bool send_standard_reply;
+		};
+		typedef struct msg_dispatch MSG_DISPATCH;
+
+		static const MSG_DISPATCH s_dispatch[MSG_DISPATCH_COUNT];
+
 		void new_reply(MESSAGE_ID id);
 
-		bool set_rtc_from_message(char * message);
-		bool get_rtc();
-		bool set_alarm_from_message(char * message);
-		bool clear_alarm_from_message(char * message);
-		bool set_trigger_from_message(char * message);
-		bool clear_trigger_from_message(char * message);
-		bool set_io_type_from_message(char * message);
-		bool read_input_from_message(char * message);
-		bool reset_from_message();
+		bool handle_batch(MESSAGE_ID id, MESSAGE_VIEW const * frame);
+		uint16_t run_batch(MESSAGE_VIEW const * frame);
+		bool run_batch_command(char const * data, size_t length);
+
+		bool set_rtc_from_message(MESSAGE_VIEW const * message);
+		bool get_rtc(MESSAGE_VIEW const * message);
+		bool set_alarm_from_message(MESSAGE_VIEW const * message);
+		bool clear_alarm_from_message(MESSAGE_VIEW const * message);
+		bool set_trigger_from_message(MESSAGE_VIEW const * message);
+		bool clear_trigger_from_message(MESSAGE_VIEW const * message);
+		bool set_io_type_from_message(MESSAGE_VIEW const * message);
+		bool read_input_from_message(MESSAGE_VIEW const * message);
+		bool reset_from_message(MESSAGE_VIEW const * message);
 
 		MSG_HANDLER_FUNCTIONS * m_callbacks;
+		bool m_validate_only; // Parse and check commands without calling back
 };
 
 #endif
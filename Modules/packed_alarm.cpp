@@ -0,0 +1,397 @@
+/*
+ * C Library Includes
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef TEST
+#include <cppunit/TestAssert.h>
+#endif
+
+/*
+ * Code Library Includes
+ */
+
+#include "Utility/util_time.h"
+#include "Utility/util_simple_parse.h"
+
+/*
+ * Application Includes
+ */
+
+#include "alarm.h"
+#include "packed_alarm.h"
+
+/*
+ * Defines and typedefs
+ */
+
+#define STATE_MASK ((1UL << 17) - 1)
+
+#define MINUTES_PER_DAY (24 * 60)
+
+/*
+ * Private Functions
+ */
+
+static const char s_intervals[] = {0, INTERVAL_HOUR, INTERVAL_DAY, INTERVAL_WEEK, INTERVAL_MONTH, INTERVAL_YEAR};
+#define N_INTERVALS ((int)sizeof(s_intervals))
+
+static int interval_index(INTERVAL interval)
+{
+	int i;
+	for (i = 1; i < N_INTERVALS; ++i)
+	{
+		if (s_intervals[i] == (char)interval) { return i; }
+	}
+	return 0;
+}
+
+static bool in_range(int value, int min, int max)
+{
+	return (value >= min) && (value <= max);
+}
+
+/*
+ * get_date_of_minute
+ *
+ * Fills the date fields for a minute of the alarm clock. The last day converted is
+ * cached, as every alarm is normally polled with the same time.
+ */
+static void get_date_of_minute(ALARM_MINUTE minute, TM * date)
+{
+	static ALARM_MINUTE s_cached_day = ALARM_MINUTE_NEVER;
+	static TM s_cached_date;
+
+	ALARM_MINUTE day = minute / MINUTES_PER_DAY;
+
+	if (day != s_cached_day)
+	{
+		seconds_to_alarm_time((UNIX_TIMESTAMP)day * MINUTES_PER_DAY * 60, &s_cached_date);
+		s_cached_day = day;
+	}
+
+	time_cpy(date, &s_cached_date);
+	date->tm_hour = (minute % MINUTES_PER_DAY) / 60;
+	date->tm_min = minute % 60;
+}
+
+/*
+ * PackedAlarm Class
+ */
+
+PackedAlarm::PackedAlarm()
+{
+	reset();
+}
+
+PackedAlarm::PackedAlarm(INTERVAL interval, TM const * const time, int repeat, int duration)
+{
+	reset();
+	(void)pack(interval, time, repeat, duration);
+}
+
+void PackedAlarm::reset()
+{
+	m_minute = 0;
+	m_hour = 0;
+	m_day = 0;
+	m_month = 0;
+	m_interval = 0;
+	m_repeat = 0;
+	m_duration = 0;
+	m_triggered = 0;
+	m_state = 0;
+}
+
+/*
+ * pack
+ *
+ * Stores the configuration of an alarm, leaving it untriggered. Returns false (and
+ * leaves the alarm unchanged) if any field will not fit.
+ */
+bool PackedAlarm::pack(INTERVAL interval, TM const * const time, int repeat, int duration)
+{
+	int index = interval_index(interval);
+
+	if (!time || !index) { return false; }
+
+	if (duration == 0) { duration = 60; } // As Alarm
+
+	bool valid = true;
+	valid &= in_range(repeat, 1, PACKED_ALARM_MAX_REPEAT);
+	valid &= in_range(duration, 1, PACKED_ALARM_MAX_DURATION);
+	valid &= in_range(time->tm_min, 0, 59);
+	valid &= in_range(time->tm_hour, 0, 23);
+	valid &= (interval != INTERVAL_WEEK) || in_range(time->tm_wday, SUN, SAT);
+	valid &= ((interval != INTERVAL_MONTH) && (interval != INTERVAL_YEAR)) || in_range(time->tm_mday, 1, 31);
+	valid &= (interval != INTERVAL_YEAR) || in_range(time->tm_mon, JAN, DEC);
+
+	if (!valid) { return false; }
+
+	reset();
+
+	m_interval = index;
+	m_repeat = repeat;
+	m_duration = duration;
+	m_minute = time->tm_min;
+
+	switch (interval)
+	{
+	case INTERVAL_YEAR:
+		m_month = time->tm_mon;
+		// Deliberate fall-through!
+	case INTERVAL_MONTH:
+		m_day = time->tm_mday;
+		m_hour = time->tm_hour;
+		break;
+	case INTERVAL_WEEK:
+		m_day = time->tm_wday;
+		m_hour = time->tm_hour;
+		break;
+	case INTERVAL_DAY:
+		m_hour = time->tm_hour;
+		break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
+/*
+ * unpack_time
+ *
+ * The inverse of pack: the alarm time with defaults for the fields not stored.
+ */
+void PackedAlarm::unpack_time(TM * time) const
+{
+	set_default_alarm_time(time);
+
+	time->tm_min = m_minute;
+	time->tm_hour = m_hour;
+
+	switch (s_intervals[m_interval])
+	{
+	case INTERVAL_YEAR:
+		time->tm_mon = m_month;
+		// Deliberate fall-through!
+	case INTERVAL_MONTH:
+		time->tm_mday = m_day;
+		break;
+	case INTERVAL_WEEK:
+		time->tm_wday = m_day;
+		break;
+	default:
+		break;
+	}
+}
+
+bool PackedAlarm::fields_match(int min, int hour, int mday, int mon, int wday) const
+{
+	bool match = (min == (int)m_minute);
+
+	switch (s_intervals[m_interval])
+	{
+	case INTERVAL_YEAR:
+		match &= (mon == (int)m_month);
+		// Deliberate fall-through!
+	case INTERVAL_MONTH:
+		match &= (mday == (int)m_day);
+		// Deliberate fall-through!
+	case INTERVAL_DAY:
+		match &= (hour == (int)m_hour);
+		break;
+	case INTERVAL_WEEK:
+		match &= (wday == (int)m_day);
+		match &= (hour == (int)m_hour);
+		break;
+	case INTERVAL_HOUR:
+		break;
+	default:
+		return false;
+	}
+
+	return match;
+}
+
+bool PackedAlarm::update(ALARM_MINUTE minute, bool match)
+{
+	if (!m_triggered)
+	{
+		if (match) { m_state++; }
+
+		if (m_state == m_repeat)
+		{
+			m_triggered = 1;
+			m_state = minute & STATE_MASK;
+		}
+	}
+	else if (((minute - m_state) & STATE_MASK) > m_duration)
+	{
+		m_triggered = 0;
+		m_state = 0;
+	}
+
+	return m_triggered;
+}
+
+bool PackedAlarm::set_current_time(TM const * const current_time)
+{
+	if (!current_time || !valid()) { return false; }
+
+	ALARM_MINUTE minute = alarm_time_to_minute(current_time);
+	bool match = !m_triggered && fields_match(current_time->tm_min, current_time->tm_hour,
+		current_time->tm_mday, current_time->tm_mon, current_time->tm_wday);
+
+	return update(minute, match);
+}
+
+bool PackedAlarm::set_current_time(UNIX_TIMESTAMP current_time)
+{
+	if (!valid()) { return false; }
+
+	ALARM_MINUTE minute = (ALARM_MINUTE)(current_time / 60);
+	bool match = false;
+
+	if (!m_triggered)
+	{
+		TM date;
+		get_date_of_minute(minute, &date);
+		match = fields_match(date.tm_min, date.tm_hour, date.tm_mday, date.tm_mon, date.tm_wday);
+	}
+
+	return update(minute, match);
+}
+
+/*
+ * from_alarm
+ *
+ * Packs an Alarm, including its repeat count and triggered state. Alarms with
+ * extra matches, or with a repeat or duration that will not fit, are rejected.
+ */
+bool PackedAlarm::from_alarm(Alarm const * const alarm)
+{
+	if (!alarm || alarm->m_extra_matches) { return false; }
+
+	if (!pack(alarm->m_alarm_interval_period, &alarm->m_datetime,
+		alarm->m_alarm_interval_count, alarm->m_duration))
+	{
+		return false;
+	}
+
+	if (alarm->m_triggered)
+	{
+		m_triggered = 1;
+		m_state = (alarm->m_deactivate_minute - alarm->m_duration) & STATE_MASK;
+	}
+	else
+	{
+		m_state = alarm->m_current_trigger_count;
+	}
+
+	return true;
+}
+
+/*
+ * to_alarm
+ *
+ * Unpacks to an Alarm. Only the low bits of the trigger minute are stored, so a
+ * triggered alarm needs the current time to recover when it will expire.
+ */
+bool PackedAlarm::to_alarm(Alarm * alarm, UNIX_TIMESTAMP now) const
+{
+	if (!alarm || !valid()) { return false; }
+
+	TM time;
+	unpack_time(&time);
+
+	*alarm = Alarm((INTERVAL)s_intervals[m_interval], &time, m_repeat, m_duration);
+
+	if (m_triggered)
+	{
+		ALARM_MINUTE now_minute = (ALARM_MINUTE)(now / 60);
+		ALARM_MINUTE trigger_minute = now_minute - ((now_minute - m_state) & STATE_MASK);
+
+		alarm->m_triggered = true;
+		alarm->update_deactivate_time(trigger_minute);
+		alarm->m_last_update_minute = now_minute;
+	}
+	else
+	{
+		alarm->m_current_trigger_count = m_state;
+	}
+
+	return true;
+}
+
+/*
+ * from_string
+ *
+ * Parses the format written by to_string (and Alarm::to_string). The year is ignored.
+ */
+bool PackedAlarm::from_string(ALARM_STRING const * const str)
+{
+	static int month_range[] = {1, 12};
+	static int mday_range[] = {1, 31};
+	static int hour_range[] = {0, 23};
+	static int minute_range[] = {0, 59};
+	static int repeat_range[] = {1, PACKED_ALARM_MAX_REPEAT};
+
+	if (!str) { return false; }
+
+	bool valid = true;
+	valid &= (str->space1 == ' ') && (str->space2 == ' ') && (str->space3 == ' ');
+	valid &= (str->r == 'r') && (str->i == 'i') && (str->d == 'd');
+	if (!valid) { return false; }
+
+	TM time;
+	int repeat;
+	int duration = 0;
+	int i;
+
+	set_default_alarm_time(&time);
+
+	if (!chars_to_weekday(&time.tm_wday, str->datetime.day)) { return false; }
+	if (!parse_chars_to_int(&time.tm_mon, str->datetime.month, 2, month_range)) { return false; }
+	if (!parse_chars_to_int(&time.tm_mday, str->datetime.date, 2, mday_range)) { return false; }
+	if (!parse_chars_to_int(&time.tm_hour, str->datetime.hour, 2, hour_range)) { return false; }
+	if (!parse_chars_to_int(&time.tm_min, str->datetime.minute, 2, minute_range)) { return false; }
+	if (!parse_chars_to_int(&repeat, str->repeat, 2, repeat_range)) { return false; }
+
+	time.tm_mon--; // Shift 1-12 month indexing to 0-11
+
+	for (i = 0; i < 5; ++i)
+	{
+		if ((str->duration[i] < '0') || (str->duration[i] > '9')) { return false; }
+		duration = (duration * 10) + (str->duration[i] - '0');
+	}
+
+	return pack((INTERVAL)str->interval, &time, repeat, duration);
+}
+
+bool PackedAlarm::to_string(ALARM_STRING * str) const
+{
+	if (!str || !valid()) { return false; }
+
+	TM time;
+	unpack_time(&time);
+
+	Alarm alarm = Alarm((INTERVAL)s_intervals[m_interval], &time, m_repeat, m_duration);
+	return alarm.to_string(str);
+}
+
+bool operator==(const PackedAlarm& lhs, const PackedAlarm& rhs)
+{
+	bool equal = true;
+	equal &= (lhs.m_minute == rhs.m_minute);
+	equal &= (lhs.m_hour == rhs.m_hour);
+	equal &= (lhs.m_day == rhs.m_day);
+	equal &= (lhs.m_month == rhs.m_month);
+	equal &= (lhs.m_interval == rhs.m_interval);
+	equal &= (lhs.m_repeat == rhs.m_repeat);
+	equal &= (lhs.m_duration == rhs.m_duration);
+	return equal;
+}
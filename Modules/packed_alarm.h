@@ -0,0 +1,64 @@
+#ifndef _PACKED_ALARM_H_
+#define _PACKED_ALARM_H_
+
+/*
+ * Defines and typedefs
+ */
+
+#define PACKED_ALARM_MAX_REPEAT (63)
+#define PACKED_ALARM_MAX_DURATION (99999) // The most ALARM_STRING can show
+
+/*
+ * PackedAlarm
+ *
+ * An alarm in 8 bytes, for applications holding very many of them. Only the fields
+ * the interval compares are stored (the day is the weekday for weekly alarms and the
+ * day of the month otherwise); the rest take the set_default_alarm_time values when
+ * unpacked, which is also how messaging builds alarms. While untriggered the state
+ * field holds the repeat count, and while triggered the minute it triggered (modulo
+ * 2^17, about 91 days, which is longer than any duration).
+ * Triggering and expiry are identical to Alarm::set_current_time while the clock
+ * only moves forwards.
+ * A zeroed PackedAlarm is an empty (invalid) slot.
+ */
+
+class PackedAlarm
+{
+public:
+	PackedAlarm();
+	PackedAlarm(INTERVAL interval, TM const * const time, int repeat, int duration);
+
+	friend bool operator==(const PackedAlarm& lhs, const PackedAlarm& rhs);
+
+	void reset();
+	bool valid() const { return m_interval != 0; }
+
+	bool from_alarm(Alarm const * const alarm);
+	bool to_alarm(Alarm * alarm, UNIX_TIMESTAMP now) const;
+
+	bool from_string(ALARM_STRING const * const str);
+	bool to_string(ALARM_STRING * str) const;
+
+	bool set_current_time(TM const * const time);
+	bool set_current_time(UNIX_TIMESTAMP time);
+	bool is_triggered() const { return m_triggered; }
+	void deactivate() { m_triggered = 0; m_state = 0; }
+
+private:
+	bool pack(INTERVAL interval, TM const * const time, int repeat, int duration);
+	void unpack_time(TM * time) const;
+	bool update(ALARM_MINUTE minute, bool match);
+	bool fields_match(int min, int hour, int mday, int mon, int wday) const;
+
+	uint64_t m_minute : 6;
+	uint64_t m_hour : 5;
+	uint64_t m_day : 5; // Weekday for weekly alarms, day of month for monthly and yearly alarms
+	uint64_t m_month : 4;
+	uint64_t m_interval : 3; // Index into s_intervals, 0 when invalid
+	uint64_t m_repeat : 6;
+	uint64_t m_duration : 17;
+	uint64_t m_triggered : 1;
+	uint64_t m_state : 17; // Repeat count, or trigger minute when triggered
+};
+
+#endif
@@ -20,15 +20,54 @@ struct token
    TokenType  Type;
    uint8_t    Value;
    char       Symbol;
+   size_t     Position;
 };
 typedef struct token Token;
 
+/*
+ * Most operators and open parentheses that can be pending at once while parsing.
+ * Long chains of one operator do not count towards it, only nesting.
+ */
+#ifndef LEP_MAX_DEPTH
+#define LEP_MAX_DEPTH (16)
+#endif
+
+/*
+ * An evaluation frame is a NOT, or an AND/OR and the index of the operand being
+ * evaluated. Parsed trees need at most two per nesting level (see reduce).
+ */
+#define LEP_EVALUATION_DEPTH ((LEP_MAX_DEPTH + 1) * 2)
+
+/*
+ * Parse errors are recorded as a code, position and value, and only formatted
+ * into m_errorMessage by LEP_GetErrorMessage
+ */
+enum leperror
+{
+   LEP_ERROR_NONE,
+   LEP_ERROR_UNEXPECTED_CHARACTER, // Value: the character
+   LEP_ERROR_UNEXPECTED_TOKEN,     // Value: the token's first character (0 at end of text)
+   LEP_ERROR_EXPECTED,             // Value: the character expected
+   LEP_ERROR_ID_TOO_LARGE,         // Value: the ID (or a prefix of it above 255)
+   LEP_ERROR_ID_OUT_OF_RANGE,      // Value: the ID
+   LEP_ERROR_NODE_POOL_FULL,       // Value: pool size
+   LEP_ERROR_ARENA_TOO_SMALL,      // Value: nodes needed
+   LEP_ERROR_SHARED_POOL_FULL,     // Value: pool size
+   LEP_ERROR_NOT_SHAREABLE,
+   LEP_ERROR_TOO_DEEP              // Value: LEP_MAX_DEPTH
+};
+typedef enum leperror LEPError;
+
 struct parser
 {
     Token m_crtToken;
     const char* m_Text;
+    size_t m_Length; // Characters from m_Index on are only read below this
     size_t m_Index;
     bool m_success;
+    LEPError m_error;
+    size_t m_errorPosition;
+    uint16_t m_errorValue;
     char m_errorMessage[30];
 };
 typedef struct parser Parser;
@@ -47,10 +86,129 @@ typedef enum astnodetype ASTNodeType;
 struct astnode
 {
    ASTNodeType Type;
-   bool      Value;
+   uint8_t   Value; // Function ID, or 0/1 for a BoolValue
+   uint8_t   Count; // Optimised trees only: number of children, stored contiguously from Left
    struct astnode*    Left;
    struct astnode*    Right;
 };
 typedef struct astnode ASTNode;
 
+/*
+ * Caller-owned storage for one parsed expression.
+ * LEP_Parse compacts the tree into Nodes, root first, and sets Count.
+ */
+struct astarena
+{
+   ASTNode* Nodes;
+   uint8_t  Capacity;
+   uint8_t  Count;
+};
+typedef struct astarena ASTArena;
+
+/*
+ * Four byte node from LEP_ParseCompact. Children are indices into the owning
+ * CompactArena (LEP_NO_NODE if absent), so one expression typically fits in a
+ * cache line or two. Only binary trees are stored this way (no Count).
+ */
+#define LEP_NO_NODE (0x3FF)
+
+struct compactnode
+{
+   uint32_t Type  : 4;  // ASTNodeType
+   uint32_t Value : 8;  // Function ID, or 0/1 for a BoolValue
+   uint32_t Left  : 10;
+   uint32_t Right : 10;
+};
+typedef struct compactnode CompactNode;
+
+struct compactarena
+{
+   CompactNode* Nodes;
+   uint16_t     Capacity; // At most LEP_NO_NODE
+   uint16_t     Count;
+};
+typedef struct compactarena CompactArena;
+
+/*
+ * Program compiled from an AST by LEP_Compile.
+ * Instructions act on a single boolean accumulator. Each is one opcode byte;
+ * LEP_OP_CALL is followed by a function ID byte and the jumps by a forward
+ * offset byte (counted from the byte after the offset).
+ */
+
+#ifndef LEP_MAX_PROGRAM_LENGTH
+#define LEP_MAX_PROGRAM_LENGTH (64)
+#endif
+
+enum lepopcode
+{
+   LEP_OP_FALSE,
+   LEP_OP_TRUE,
+   LEP_OP_CALL,
+   LEP_OP_NOT,
+   LEP_OP_JUMP_IF_FALSE, // Short-circuits an AND
+   LEP_OP_JUMP_IF_TRUE   // Short-circuits an OR
+};
+typedef enum lepopcode LEPOpcode;
+
+struct lepprogram
+{
+   uint8_t Code[LEP_MAX_PROGRAM_LENGTH];
+   uint8_t Length;
+};
+typedef struct lepprogram LEPProgram;
+
+/*
+ * Truth table compiled from an AST by LEP_CompileTable.
+ * Bit n of Bits is the result when input i (function ID Inputs[i]) has the value
+ * of bit i of n. Only expressions using at most LEP_TABLE_MAX_INPUTS distinct
+ * functions, all with IDs below 32, can be tabulated.
+ */
+
+#ifndef LEP_TABLE_MAX_INPUTS
+#define LEP_TABLE_MAX_INPUTS (12)
+#endif
+
+typedef uint32_t LEPINPUTS; // Packed snapshot: bit n is the result of function n
+
+struct leptable
+{
+   uint8_t Bits[((1UL << LEP_TABLE_MAX_INPUTS) + 7) / 8];
+   uint8_t Inputs[LEP_TABLE_MAX_INPUTS];
+   uint8_t InputCount;
+   bool    Direct; // Inputs are function IDs 0 to InputCount-1, so the snapshot is the index
+};
+typedef struct leptable LEPTable;
+
+/*
+ * 256 time steps for LEP_EvaluateBatch256: bit n of Words[w] is step 64w + n
+ */
+
+struct lepbatch256
+{
+   uint64_t Words[4];
+};
+typedef struct lepbatch256 LEPBatch256;
+
+/*
+ * An expression prepared by LEP_Prepare in the fastest form that fits it
+ */
+
+enum lepmode
+{
+   LEP_MODE_TREE,
+   LEP_MODE_PROGRAM,
+   LEP_MODE_TABLE
+};
+typedef enum lepmode LEPMode;
+
+struct lepexpression
+{
+   LEPMode    Mode;
+   ASTNode*   Tree;
+   LEPProgram Program;
+   LEPTable   Table;
+};
+typedef struct lepexpression LEPExpression;
+
 #endif
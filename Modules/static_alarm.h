@@ -0,0 +1,150 @@
+#ifndef _STATIC_ALARM_H_
+#define _STATIC_ALARM_H_
+
+/*
+ * Defines and typedefs
+ */
+
+/*
+ * The changing part of a StaticAlarm, kept apart so that the configuration can be const
+ * (and constexpr arrays of it placed in read-only memory). Zero-initialise before use.
+ */
+struct static_alarm_state
+{
+	ALARM_MINUTE deactivate_minute;
+	uint8_t count;
+	bool triggered;
+};
+typedef struct static_alarm_state STATIC_ALARM_STATE;
+
+/*
+ * StaticAlarm
+ *
+ * An alarm whose interval is fixed at compile time, so the field comparison for that
+ * interval is chosen by the compiler instead of by a switch on every tick.
+ * day is the weekday for weekly alarms and the day of the month for monthly and
+ * yearly alarms; fields the interval does not compare are ignored.
+ * Triggering and expiry are identical to Alarm::set_current_time.
+ * A field out of range for the interval makes a constexpr StaticAlarm fail to compile.
+ */
+
+template<INTERVAL I> struct static_alarm_match;
+
+/*
+ * Deliberately not constexpr: reaching it stops constant evaluation
+ */
+inline int static_alarm_out_of_range(int value) { return value; }
+
+constexpr int static_alarm_checked(int value, int min, int max)
+{
+	return ((value >= min) && (value <= max)) ? value : static_alarm_out_of_range(value);
+}
+
+template<INTERVAL I>
+class StaticAlarm
+{
+public:
+	constexpr StaticAlarm(uint8_t repeat, int duration, uint8_t minute, uint8_t hour = 0, uint8_t day = 1, uint8_t month = JAN) :
+		m_minute(static_alarm_checked(minute, 0, 59)),
+		m_hour((I == INTERVAL_HOUR) ? hour : static_alarm_checked(hour, 0, 23)),
+		m_day((I == INTERVAL_WEEK) ? static_alarm_checked(day, SUN, SAT) :
+			((I == INTERVAL_MONTH) || (I == INTERVAL_YEAR)) ? static_alarm_checked(day, 1, 31) : day),
+		m_month((I == INTERVAL_YEAR) ? static_alarm_checked(month, JAN, DEC) : month),
+		m_repeat(static_alarm_checked(repeat, 1, UINT8_MAX)),
+		m_duration((duration >= 0) ? (duration ? duration : 60) : static_alarm_out_of_range(duration))
+	{}
+
+	constexpr bool matches(int min, int hour, int mday, int mon, int wday) const
+	{
+		return static_alarm_match<I>::matches(*this, min, hour, mday, mon, wday);
+	}
+
+	bool set_current_time(STATIC_ALARM_STATE * state, TM const * const time) const
+	{
+		if (!state || !time) { return false; }
+
+		ALARM_MINUTE minute = alarm_time_to_minute(time);
+
+		if (!state->triggered)
+		{
+			if (matches(time->tm_min, time->tm_hour, time->tm_mday, time->tm_mon, time->tm_wday)) { state->count++; }
+
+			state->triggered = (state->count == m_repeat);
+
+			if (state->triggered)
+			{
+				state->count = 0;
+				state->deactivate_minute = minute + m_duration;
+			}
+		}
+		else
+		{
+			state->triggered = minute <= state->deactivate_minute;
+		}
+
+		return state->triggered;
+	}
+
+	Alarm to_alarm() const
+	{
+		TM time;
+		set_default_alarm_time(&time);
+		time.tm_min = m_minute;
+		time.tm_hour = m_hour;
+		if (I == INTERVAL_WEEK) { time.tm_wday = m_day; } else { time.tm_mday = m_day; }
+		time.tm_mon = m_month;
+		return Alarm(I, &time, m_repeat, m_duration);
+	}
+
+private:
+	friend struct static_alarm_match<I>;
+
+	uint8_t m_minute;
+	uint8_t m_hour;
+	uint8_t m_day;
+	uint8_t m_month;
+	uint8_t m_repeat;
+	int m_duration; // As Alarm, so long durations are not truncated
+};
+
+template<> struct static_alarm_match<INTERVAL_HOUR>
+{
+	static constexpr bool matches(StaticAlarm<INTERVAL_HOUR> const& a, int min, int, int, int, int)
+	{
+		return min == a.m_minute;
+	}
+};
+
+template<> struct static_alarm_match<INTERVAL_DAY>
+{
+	static constexpr bool matches(StaticAlarm<INTERVAL_DAY> const& a, int min, int hour, int, int, int)
+	{
+		return (min == a.m_minute) && (hour == a.m_hour);
+	}
+};
+
+template<> struct static_alarm_match<INTERVAL_WEEK>
+{
+	static constexpr bool matches(StaticAlarm<INTERVAL_WEEK> const& a, int min, int hour, int, int, int wday)
+	{
+		return (min == a.m_minute) && (hour == a.m_hour) && (wday == a.m_day);
+	}
+};
+
+template<> struct static_alarm_match<INTERVAL_MONTH>
+{
+	static constexpr bool matches(StaticAlarm<INTERVAL_MONTH> const& a, int min, int hour, int mday, int, int)
+	{
+		return (min == a.m_minute) && (hour == a.m_hour) && (mday == a.m_day);
+	}
+};
+
+template<> struct static_alarm_match<INTERVAL_YEAR>
+{
+	static constexpr bool matches(StaticAlarm<INTERVAL_YEAR> const& a, int min, int hour, int mday, int mon, int)
+	{
+		return (min == a.m_minute) && (hour == a.m_hour) && (mday == a.m_day) && (mon == a.m_month);
+	}
+};
+
+#endif
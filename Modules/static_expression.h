@@ -0,0 +1,158 @@
+#ifndef _STATIC_EXPRESSION_H_
+#define _STATIC_EXPRESSION_H_
+
+/*
+ * Defines and typedefs
+ */
+
+/*
+ * Never defined: reaching it while compiling a constant expression stops the build,
+ * and the compiler's "call to non-constexpr function" note carries the message.
+ */
+void lep_static_expression_error(char const * message);
+
+/*
+ * StaticExpressionCompiler
+ *
+ * Compiles the LEP_Parse grammar (&, |, !, parentheses, T, F and function IDs, with |
+ * binding more tightly than &) to the same bytecode as LEP_Compile, entirely at
+ * compile time. Use through LEP_StaticCompile.
+ */
+
+class StaticExpressionCompiler
+{
+public:
+	constexpr StaticExpressionCompiler(char const * text, uint8_t functions) :
+		m_text(text), m_index(0), m_functions(functions), m_program()
+	{}
+
+	constexpr LEPProgram compile()
+	{
+		expression();
+		if (peek()) { lep_static_expression_error("Unexpected character after expression"); }
+		return m_program;
+	}
+
+private:
+	static constexpr uint8_t NO_JUMP = 0xFF;
+
+	constexpr char peek()
+	{
+		while ((m_text[m_index] == ' ') || (m_text[m_index] == '\t') || (m_text[m_index] == '\r') || (m_text[m_index] == '\n'))
+		{
+			m_index++;
+		}
+		return m_text[m_index];
+	}
+
+	constexpr void emit(uint8_t byte)
+	{
+		if (m_program.Length == LEP_MAX_PROGRAM_LENGTH) { lep_static_expression_error("Expression exceeds LEP_MAX_PROGRAM_LENGTH"); }
+		m_program.Code[m_program.Length++] = byte;
+	}
+
+	// Chain of jumps to patch through their offset bytes, as in LEP_Compile
+	constexpr void jump(uint8_t opcode, uint8_t & chain)
+	{
+		emit(opcode);
+		emit(chain);
+		chain = m_program.Length - 1;
+	}
+
+	constexpr void patch(uint8_t chain)
+	{
+		while (chain != NO_JUMP)
+		{
+			uint8_t previous = m_program.Code[chain];
+			m_program.Code[chain] = m_program.Length - (chain + 1);
+			chain = previous;
+		}
+	}
+
+	constexpr void expression()
+	{
+		uint8_t chain = NO_JUMP;
+		term();
+		while (peek() == '&')
+		{
+			m_index++;
+			jump(LEP_OP_JUMP_IF_FALSE, chain);
+			term();
+		}
+		patch(chain);
+	}
+
+	constexpr void term()
+	{
+		uint8_t chain = NO_JUMP;
+		factor();
+		while (peek() == '|')
+		{
+			m_index++;
+			jump(LEP_OP_JUMP_IF_TRUE, chain);
+			factor();
+		}
+		patch(chain);
+	}
+
+	constexpr void factor()
+	{
+		char c = peek();
+
+		if (c == '!')
+		{
+			m_index++;
+			factor();
+			emit(LEP_OP_NOT);
+		}
+		else if (c == '(')
+		{
+			m_index++;
+			expression();
+			if (peek() != ')') { lep_static_expression_error("Expected ')'"); }
+			m_index++;
+		}
+		else if ((c == 'T') || (c == 'F'))
+		{
+			m_index++;
+			emit(c == 'T' ? LEP_OP_TRUE : LEP_OP_FALSE);
+		}
+		else if ((c >= '0') && (c <= '9'))
+		{
+			unsigned int fid = 0;
+			while ((m_text[m_index] >= '0') && (m_text[m_index] <= '9'))
+			{
+				fid = (fid * 10) + (m_text[m_index++] - '0');
+				if (fid > 255) { lep_static_expression_error("Function ID exceeds 255"); }
+			}
+			if (fid >= m_functions) { lep_static_expression_error("Function ID exceeds NUMBER_OF_IO + NUMBER_OF_ALARMS"); }
+			emit(LEP_OP_CALL);
+			emit((uint8_t)fid);
+		}
+		else
+		{
+			lep_static_expression_error("Expected a function ID, T, F, '!' or '('");
+		}
+	}
+
+	char const * m_text;
+	uint8_t m_index;
+	uint8_t m_functions;
+	LEPProgram m_program;
+};
+
+/*
+ * LEP_StaticCompile
+ *
+ * Declare the result constexpr so that it is compiled (and any error reported) at
+ * build time, e.g.
+ *    static constexpr LEPProgram s_program = LEP_StaticCompile("1&!(2|T)");
+ * then evaluate with LEP_Run(&s_program).
+ */
+template<size_t N>
+constexpr LEPProgram LEP_StaticCompile(char const (&text)[N])
+{
+	return StaticExpressionCompiler(text, NUMBER_OF_IO + NUMBER_OF_ALARMS).compile();
+}
+
+#endif
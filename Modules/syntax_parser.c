@@ -8,10 +8,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <ctype.h>
 #include <string.h>
 #include <stdbool.h>
 
+#if defined(__AVX2__) && !defined(LEP_NO_SIMD)
+#include <immintrin.h>
+#define LEP_AVX2
+#endif
+
 /*
  * Local Module Includes
  */
@@ -25,6 +29,65 @@
 
 #include "app.config.h"
 
+/*
+ * Defines and Typedefs
+ */
+
+#if LEP_MAX_PROGRAM_LENGTH > 255
+#error "LEP_MAX_PROGRAM_LENGTH must fit in the uint8_t program length"
+#endif
+
+#define NO_JUMP (0xFF)
+
+#if LEP_TABLE_MAX_INPUTS > 15
+#error "LEP_TABLE_MAX_INPUTS must index the table with 16 bits"
+#endif
+
+#define CHAR_SPACE (0xFF) // Not a TokenType: skipped by getNextToken
+#define LEP_NUL_TERMINATED ((size_t)-1) // Text length for startParse: read up to the NUL
+
+#define P_ONE (256) // Fixed point probability of 1
+
+struct functionstats
+{
+    uint16_t Calls;
+    uint16_t Trues;
+    uint32_t Cost; // Total clock ticks spent in the function
+};
+typedef struct functionstats FunctionStats;
+
+struct operand
+{
+    uint16_t Node;
+    uint16_t Tail; // Last node of Node's chain of one binary operator, or LEP_NO_NODE
+};
+typedef struct operand Operand;
+
+struct parsestack
+{
+    TokenType Operators[LEP_MAX_DEPTH];
+    Operand Operands[LEP_MAX_DEPTH + 1];
+    uint8_t OperatorCount;
+    uint8_t OperandCount;
+};
+typedef struct parsestack ParseStack;
+
+struct evaluationframe
+{
+    ASTNode * Node;
+    uint8_t Index;
+};
+typedef struct evaluationframe EvaluationFrame;
+
+typedef char compactNodeIsFourBytes[(sizeof(CompactNode) == 4) ? 1 : -1];
+
+struct estimate
+{
+    uint32_t Cost;  // Expected clock ticks to evaluate
+    uint16_t PTrue; // Probability of true, out of P_ONE
+};
+typedef struct estimate Estimate;
+
 /*
  * Local Variables
  */
@@ -32,330 +95,1573 @@
 static const int s_num_of_functions = NUMBER_OF_IO+NUMBER_OF_ALARMS;
 static BOOLFUNCTION s_functions[s_num_of_functions];
 
+
+/* Token type of each character (CHAR_SPACE for whitespace). Characters after '|'
+ * are all Error, the zero value, so are left to the initialiser. */
+static const uint8_t s_charClass[256] = {
+    /* 0x00 */ EndOfText, Error, Error, Error, Error, Error, Error, Error,
+    /* 0x08 */ Error, CHAR_SPACE, CHAR_SPACE, CHAR_SPACE, CHAR_SPACE, CHAR_SPACE, Error, Error,
+    /* 0x10 */ Error, Error, Error, Error, Error, Error, Error, Error,
+    /* 0x18 */ Error, Error, Error, Error, Error, Error, Error, Error,
+    /* 0x20 */ CHAR_SPACE, Not, Error, Error, Error, Error, And, Error,
+    /* 0x28 */ OpenParenthesis, ClosedParenthesis, Error, Error, Error, Error, Error, Error,
+    /* 0x30 */ Number, Number, Number, Number, Number, Number, Number, Number,
+    /* 0x38 */ Number, Number, Error, Error, Error, Error, Error, Error,
+    /* 0x40 */ Error, Error, Error, Error, Error, Error, BoolChar, Error,
+    /* 0x48 */ Error, Error, Error, Error, Error, Error, Error, Error,
+    /* 0x50 */ Error, Error, Error, Error, BoolChar, Error, Error, Error,
+    /* 0x58 */ Error, Error, Error, Error, Error, Error, Error, Error,
+    /* 0x60 */ Error, Error, Error, Error, Error, Error, Error, Error,
+    /* 0x68 */ Error, Error, Error, Error, Error, Error, Error, Error,
+    /* 0x70 */ Error, Error, Error, Error, Error, Error, Error, Error,
+    /* 0x78 */ Error, Error, Error, Error, Or
+};
+
+static bool s_adaptive = false;
+static bool s_tooDeep = false; // The last evaluation gave up (see LEP_EvaluationTooDeep)
+static LEPCLOCK s_clock = NULL;
+static FunctionStats s_stats[s_num_of_functions];
+
 /*
  * Local Function Prototypes
  */
 
-static ASTNode* expression(Parser * parser);
-static ASTNode* expression1(Parser * parser);
-static ASTNode* term(Parser * parser);
-static ASTNode* term1(Parser * parser);
-static ASTNode* Factor(Parser * parser);
-static void match(Parser * parser, char expected);
-static void skipWhitespaces(Parser * parser);
 static void getNextToken(Parser * parser);
+static bool compileNode(ASTNode * ast, LEPProgram * program);
+static ASTNode* simplify(ASTNode * node);
+static uint8_t operandCount(ASTNode const * node, ASTNodeType type);
+static uint8_t layoutSize(ASTNode const * node);
+static void layout(ASTNode const * node, ASTNode * slot, ASTArena * arena);
 
 static bool defaultFn(void) { return false; }
 
-static ASTNode* expression(Parser * parser)
+/* callFunction
+ * Call a registered function, recording its result and cost in adaptive mode
+ */
+static bool callFunction(uint8_t fid)
 {
-    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
-    DEBUG ( printf("%s\n", __func__) );
+    if (!s_adaptive) { return s_functions[fid](); }
+
+    FunctionStats * stats = &s_stats[fid];
+    uint32_t start = s_clock ? s_clock() : 0;
+    bool result = s_functions[fid]();
 
-    ASTNode* tnode = term(parser);
-    ASTNode* e1node = expression1(parser);
+    if (stats->Calls == UINT16_MAX)
+    {
+        // Halve the history so that recent behaviour counts for more
+        stats->Calls /= 2;
+        stats->Trues /= 2;
+        stats->Cost /= 2;
+    }
 
-    return AST_CreateNode(parser, OperatorAnd, tnode, e1node);
+    stats->Calls++;
+    stats->Trues += result;
+    stats->Cost += s_clock ? (s_clock() - start) : 1;
+
+    return result;
 }
 
-static ASTNode* expression1(Parser * parser)
+/* precedence
+ * Binding strength of an operator token: ! then | then &. An open parenthesis
+ * has none, so nothing is reduced past it.
+ */
+static uint8_t precedence(TokenType op)
 {
-    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
-    DEBUG( printf("%s\n", __func__) );
+    switch(op)
+    {
+        case Not: return 3;
+        case Or: return 2;
+        case And: return 1;
+        default: return 0;
+    }
+}
 
-    ASTNode* tnode;
-    ASTNode* e1node;
+/* newNode
+ * Append a node to the compact arena, or without one (NULL) to the shared ASTNode
+ * pool, returning its index (LEP_NO_NODE if full)
+ */
+static uint16_t newNode(Parser * parser, CompactArena * arena, ASTNodeType type, uint8_t value, uint16_t left, uint16_t right)
+{
+    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, LEP_NO_NODE);
 
-    switch(parser->m_crtToken.Type)
+    if (!arena)
     {
-        case And:
-            getNextToken(parser);
-            tnode = term(parser);
-            e1node = expression1(parser);
-            return AST_CreateNode(parser, OperatorAnd, e1node, tnode);
-        break;
-        default:
-            break;
+        switch(type)
+        {
+            case FunctionID:
+                return AST_PoolIndex(AST_CreateNodeBoolFunction(parser, value));
+            case BoolValue:
+                return AST_PoolIndex(AST_CreateNodeBoolValue(parser, value));
+            case UnaryNot:
+                return AST_PoolIndex(AST_CreateUnaryNode(parser, AST_PoolNode(left)));
+            default:
+                return AST_PoolIndex(AST_CreateNode(parser, type, AST_PoolNode(left), AST_PoolNode(right)));
+        }
+    }
+
+    if (arena->Count == arena->Capacity)
+    {
+        LEP_SetError(parser, LEP_ERROR_NODE_POOL_FULL, parser->m_crtToken.Position, arena->Capacity);
+        return LEP_NO_NODE;
     }
 
-    return AST_CreateNodeBoolValue(parser, true);
+    CompactNode * node = &arena->Nodes[arena->Count];
+    node->Type = type;
+    node->Value = value;
+    node->Left = left;
+    node->Right = right;
+
+    return arena->Count++;
 }
 
-static ASTNode* term(Parser * parser)
+/* nodeType, nodeRight, setNodeRight
+ * Access a node built by newNode, in the arena or the pool
+ */
+static ASTNodeType nodeType(CompactArena const * arena, uint16_t index)
 {
-    DEBUG( printf("%s\n", __func__) );
+    return arena ? (ASTNodeType)arena->Nodes[index].Type : AST_PoolNode(index)->Type;
+}
 
-    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
-    ASTNode* fnode = Factor(parser);
-    ASTNode* t1node = term1(parser);
+static uint16_t nodeRight(CompactArena const * arena, uint16_t index)
+{
+    return arena ? (uint16_t)arena->Nodes[index].Right : AST_PoolIndex(AST_PoolNode(index)->Right);
+}
 
-    return AST_CreateNode(parser, OperatorOr, fnode, t1node);
+static void setNodeRight(CompactArena * arena, uint16_t index, uint16_t right)
+{
+    if (arena) { arena->Nodes[index].Right = right; }
+    else { AST_PoolNode(index)->Right = AST_PoolNode(right); }
 }
 
-static ASTNode* term1(Parser * parser)
+/* reduce
+ * Apply the operator on top of the stack to the operands on top of theirs.
+ * A chain of the same binary operator is built leaning right (a&(b&(c&d)))
+ * by appending to the chain's last node, so that evaluating it needs no stack.
+ */
+static void reduce(Parser * parser, ParseStack * stack, CompactArena * arena)
 {
-    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
-    DEBUG( printf("%s\n", __func__) );
+    ON_PARSER_ERROR_EXIT_EARLY(parser);
 
-    ASTNode* fnode;
-    ASTNode* t1node;
+    TokenType op = stack->Operators[--stack->OperatorCount];
+    Operand * right = &stack->Operands[--stack->OperandCount];
+    Operand * left;
+    ASTNodeType type;
+    uint16_t node;
 
-    switch(parser->m_crtToken.Type)
+    if (op == Not)
     {
-        case Or:
-            getNextToken(parser);
-            fnode = Factor(parser);
-            t1node = term1(parser);
-            return AST_CreateNode(parser, OperatorOr, t1node, fnode);
-        break;
-        default:
-            break;
+        right->Node = newNode(parser, arena, UnaryNot, 0, right->Node, LEP_NO_NODE);
+        right->Tail = LEP_NO_NODE;
+        stack->OperandCount++;
+        return;
+    }
+
+    type = (op == And) ? OperatorAnd : OperatorOr;
+    left = &stack->Operands[stack->OperandCount - 1];
+
+    if ((left->Tail != LEP_NO_NODE) && (nodeType(arena, left->Node) == type))
+    {
+        node = newNode(parser, arena, type, 0, nodeRight(arena, left->Tail), right->Node);
+        setNodeRight(arena, left->Tail, node);
+    }
+    else
+    {
+        node = newNode(parser, arena, type, 0, left->Node, right->Node);
+        left->Node = node;
+    }
+
+    left->Tail = node;
+}
+
+/* pushOperator
+ * Fails with LEP_ERROR_TOO_DEEP once LEP_MAX_DEPTH operators are pending
+ */
+static void pushOperator(Parser * parser, ParseStack * stack, TokenType op)
+{
+    ON_PARSER_ERROR_EXIT_EARLY(parser);
+
+    if (stack->OperatorCount == LEP_MAX_DEPTH)
+    {
+        LEP_SetError(parser, LEP_ERROR_TOO_DEEP, parser->m_crtToken.Position, LEP_MAX_DEPTH);
+        return;
     }
 
-    return AST_CreateNodeBoolValue(parser, false);
+    stack->Operators[stack->OperatorCount++] = op;
 }
 
-static ASTNode* Factor(Parser * parser)
+/* parseExpression
+ * Shunting-yard parse of the whole text into compact nodes (or pool nodes without an arena), without recursion.
+ * Returns the root's index, or LEP_NO_NODE on error.
+ */
+static uint16_t parseExpression(Parser * parser, CompactArena * arena)
 {
-    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
-    DEBUG( printf("%s\n", __func__) );
+    ParseStack stack;
+    bool expectOperand = true;
+    TokenType type;
 
-    ASTNode* node;
-    uint8_t value;
+    stack.OperatorCount = 0;
+    stack.OperandCount = 0;
+    if (arena) { arena->Count = 0; }
 
-    switch(parser->m_crtToken.Type)
+    while (parser->m_success)
     {
-        case OpenParenthesis:
-            getNextToken(parser);
-            node = expression(parser);
-            match(parser, ')');
-            return node;
+        type = parser->m_crtToken.Type;
+
+        if (expectOperand)
+        {
+            switch(type)
+            {
+                case Number:
+                case BoolChar:
+                    // Never more operands than pending operators + 1
+                    stack.Operands[stack.OperandCount].Node = newNode(parser, arena,
+                        (type == Number) ? FunctionID : BoolValue, parser->m_crtToken.Value, LEP_NO_NODE, LEP_NO_NODE);
+                    stack.Operands[stack.OperandCount++].Tail = LEP_NO_NODE;
+                    expectOperand = false;
+                    break;
+                case Not:
+                case OpenParenthesis:
+                    pushOperator(parser, &stack, type);
+                    break;
+                default:
+                    LEP_SetError(parser, LEP_ERROR_UNEXPECTED_TOKEN, parser->m_crtToken.Position, (uint8_t)parser->m_crtToken.Symbol);
+                    break;
+            }
+        }
+        else
+        {
+            switch(type)
+            {
+                case And:
+                case Or:
+                    // Everything bound at least as tightly is complete (left associative)
+                    while (parser->m_success && stack.OperatorCount && (precedence(stack.Operators[stack.OperatorCount - 1]) >= precedence(type)))
+                    {
+                        reduce(parser, &stack, arena);
+                    }
+                    pushOperator(parser, &stack, type);
+                    expectOperand = true;
+                    break;
+                case ClosedParenthesis:
+                    while (parser->m_success && stack.OperatorCount && (stack.Operators[stack.OperatorCount - 1] != OpenParenthesis))
+                    {
+                        reduce(parser, &stack, arena);
+                    }
+                    if (!stack.OperatorCount)
+                    {
+                        LEP_SetError(parser, LEP_ERROR_UNEXPECTED_TOKEN, parser->m_crtToken.Position, ')');
+                        break;
+                    }
+                    stack.OperatorCount--;
+                    break;
+                case EndOfText:
+                    while (parser->m_success && stack.OperatorCount && (stack.Operators[stack.OperatorCount - 1] != OpenParenthesis))
+                    {
+                        reduce(parser, &stack, arena);
+                    }
+                    if (stack.OperatorCount)
+                    {
+                        LEP_SetError(parser, LEP_ERROR_EXPECTED, parser->m_crtToken.Position, ')');
+                        break;
+                    }
+                    return parser->m_success ? stack.Operands[0].Node : LEP_NO_NODE;
+                default:
+                    LEP_SetError(parser, LEP_ERROR_UNEXPECTED_TOKEN, parser->m_crtToken.Position, (uint8_t)parser->m_crtToken.Symbol);
+                    break;
+            }
+        }
+
+        getNextToken(parser);
+    }
+
+    return LEP_NO_NODE;
+}
+
+/* startParse
+ * Reset the parser for a new text and read its first token. The text ends at
+ * its NUL or after length characters, whichever comes first.
+ */
+static void startParse(Parser * parser, const char* text, size_t length)
+{
+    parser->m_Text = text;
+    parser->m_Length = length;
+    parser->m_Index = 0;
+    parser->m_success = true;
+    parser->m_error = LEP_ERROR_NONE;
 
-        case Not:
-            getNextToken(parser);
-            node = Factor(parser);
-            return AST_CreateUnaryNode(parser, node);
+    getNextToken(parser);
+}
 
+/* charClassAt
+ * Token type of the character at index, or EndOfText past the text's length
+ */
+static uint8_t charClassAt(Parser const * parser, size_t index)
+{
+    return (index < parser->m_Length) ? s_charClass[(uint8_t)parser->m_Text[index]] : (uint8_t)EndOfText;
+}
+
+/* getNextToken
+ * Skip to the next token in the input string and tag appropriately for processing.
+ * Each character is classified by a single lookup in s_charClass.
+ */
+static void getNextToken(Parser * parser)
+{
+    ON_PARSER_ERROR_EXIT_EARLY(parser);
+
+    const char * text = parser->m_Text;
+    size_t index = parser->m_Index;
+    uint8_t charClass;
+    uint16_t value = 0;
+
+    while ((charClass = charClassAt(parser, index)) == CHAR_SPACE) { index++; }
+
+    parser->m_crtToken.Type = (TokenType)charClass;
+    parser->m_crtToken.Symbol = (charClass == EndOfText) ? '\0' : text[index];
+    parser->m_crtToken.Position = index;
+    parser->m_crtToken.Value = 0;
+
+    switch(charClass)
+    {
         case Number:
-            value = parser->m_crtToken.Value;
-            getNextToken(parser);
-            return AST_CreateNodeBoolFunction(parser, value);
+            // Stop accumulating once too large, but consume every digit
+            while (charClassAt(parser, index) == Number)
+            {
+                if (value <= 255) { value = (value * 10) + (text[index] - '0'); }
+                index++;
+            }
+
+            if (value > 255)
+            {
+                LEP_SetError(parser, LEP_ERROR_ID_TOO_LARGE, parser->m_crtToken.Position, value);
+            }
+            else if (value >= s_num_of_functions)
+            {
+                LEP_SetError(parser, LEP_ERROR_ID_OUT_OF_RANGE, parser->m_crtToken.Position, value);
+            }
+            parser->m_crtToken.Value = (uint8_t)value;
+            break;
 
         case BoolChar:
-            value = parser->m_crtToken.Value;
-            getNextToken(parser);
-            return AST_CreateNodeBoolValue(parser, (bool)value);
+            parser->m_crtToken.Value = (uint8_t)(text[index] == 'T');
+            index++;
+            break;
+
+        case EndOfText:
+            break;
+
+        case Error:
+            LEP_SetError(parser, LEP_ERROR_UNEXPECTED_CHARACTER, index, (uint8_t)text[index]);
+            break;
+
         default:
-            parser->m_success = false;
-            snprintf(parser->m_errorMessage, sizeof(parser->m_errorMessage), "%s: At position %d unexpected token '%c'",
-                __func__, (int)parser->m_Index, parser->m_crtToken.Symbol);
-            return NULL;
+            index++; // Single character operators and parentheses
+            break;
     }
-}
 
+    parser->m_Index = index;
+}
 
-/* match
- * Check that the parser is at the expected char and jump over it (do not process)
+/* LEP_SetError
+ * Record the first error of a parse. The message is formatted on demand by LEP_GetErrorMessage.
  */
-static void match(Parser * parser, char expected)
+void LEP_SetError(Parser * parser, LEPError error, size_t position, uint16_t value)
 {
     ON_PARSER_ERROR_EXIT_EARLY(parser);
 
-    if(parser->m_Text[parser->m_Index-1] == expected)
+    parser->m_success = false;
+    parser->m_error = error;
+    parser->m_errorPosition = position;
+    parser->m_errorValue = value;
+}
+
+/* LEP_GetErrorMessage
+ * Format the parser's error into its m_errorMessage buffer and return it
+ * ("" if the last parse succeeded)
+ */
+const char * LEP_GetErrorMessage(Parser * parser)
+{
+    char * buffer = parser->m_errorMessage;
+    size_t size = sizeof(parser->m_errorMessage);
+    int position = (int)parser->m_errorPosition;
+    unsigned int value = parser->m_errorValue;
+
+    switch(parser->m_error)
     {
-        getNextToken(parser);
+        case LEP_ERROR_NONE:
+            buffer[0] = '\0';
+            break;
+        case LEP_ERROR_UNEXPECTED_CHARACTER:
+            snprintf(buffer, size, "Bad character '%c' at %d", (char)value, position);
+            break;
+        case LEP_ERROR_UNEXPECTED_TOKEN:
+            if (value) { snprintf(buffer, size, "Unexpected '%c' at %d", (char)value, position); }
+            else { snprintf(buffer, size, "Unexpected end at %d", position); }
+            break;
+        case LEP_ERROR_EXPECTED:
+            snprintf(buffer, size, "Expected '%c' at %d", (char)value, position);
+            break;
+        case LEP_ERROR_ID_TOO_LARGE:
+            snprintf(buffer, size, "ID %u exceeds 255 at %d", value, position);
+            break;
+        case LEP_ERROR_ID_OUT_OF_RANGE:
+            snprintf(buffer, size, "ID %u not below %d at %d", value, s_num_of_functions, position);
+            break;
+        case LEP_ERROR_NODE_POOL_FULL:
+            snprintf(buffer, size, "More than %u nodes", value);
+            break;
+        case LEP_ERROR_ARENA_TOO_SMALL:
+            snprintf(buffer, size, "Arena needs %u nodes", value);
+            break;
+        case LEP_ERROR_SHARED_POOL_FULL:
+            snprintf(buffer, size, "More than %u shared nodes", value);
+            break;
+        case LEP_ERROR_NOT_SHAREABLE:
+            snprintf(buffer, size, "Optimised trees not shareable");
+            break;
+        case LEP_ERROR_TOO_DEEP:
+            snprintf(buffer, size, "Nested over %u deep at %d", value, position);
+            break;
     }
-    else
+
+    return buffer;
+}
+
+/* LEP_Init
+ * Initialises this module
+ */
+void LEP_Init(void)
+{
+    uint8_t i;
+    for (i = 0; i < s_num_of_functions; ++i)
     {
-        parser->m_success = false;
-        snprintf(parser->m_errorMessage, sizeof(parser->m_errorMessage), "At position %d unexpected token '%c' (Line %d)",
-            (int)parser->m_Index, expected, __LINE__);
+        // Ensure all functions start off pointing at the root
+        s_functions[i] = defaultFn;
+        s_stats[i].Calls = 0;
+        s_stats[i].Trues = 0;
+        s_stats[i].Cost = 0;
     }
 }
 
-/* skipWhitespaces
- * Jump the parser ahead over whitespace
+/* LEP_Evaluate
+ * Evaluate the AST starting at the given root node, using an explicit stack.
+ * Operands of AND and OR are evaluated in order and stop as soon as the result is
+ * known, so later functions may not be called. The second operand of a binary node
+ * takes no stack, so right-leaning chains from LEP_Parse evaluate in constant space.
+ * A tree nested deeper than LEP_EVALUATION_DEPTH is not evaluated: false is returned
+ * and LEP_EvaluationTooDeep reports it.
  */
-static void skipWhitespaces(Parser * parser)
+bool LEP_Evaluate(ASTNode* ast)
 {
-    ON_PARSER_ERROR_EXIT_EARLY(parser);
-    while(isspace(parser->m_Text[parser->m_Index])) parser->m_Index++;
+    EvaluationFrame stack[LEP_EVALUATION_DEPTH];
+    uint8_t depth = 0;
+    bool value = false;
+
+    s_tooDeep = false;
+
+    if(ast == NULL) { return false; }
+
+    while (true)
+    {
+        // Descend to a leaf, remembering every node that still has work to do
+        while ((ast->Type == UnaryNot) || (ast->Type == OperatorAnd) || (ast->Type == OperatorOr))
+        {
+            if (depth == LEP_EVALUATION_DEPTH) { s_tooDeep = true; return false; }
+
+            stack[depth].Node = ast;
+            stack[depth++].Index = 0;
+            ast = ast->Count ? &ast->Left[0] : ast->Left;
+        }
+
+        if (ast->Type == FunctionID)
+        {
+            // Invoke the boolean function for the node
+            value = callFunction(ast->Value);
+        }
+        else
+        {
+            value = (ast->Type == BoolValue) && ast->Value;
+        }
+
+        // Ascend until a node needs another operand evaluated
+        ast = NULL;
+        while (depth && !ast)
+        {
+            EvaluationFrame * frame = &stack[depth - 1];
+            ASTNode * node = frame->Node;
+            bool decisive = (node->Type == OperatorOr); // Stops an AND if false, an OR if true
+
+            if (node->Type == UnaryNot)
+            {
+                value = !value;
+                depth--;
+            }
+            else if (value == decisive)
+            {
+                depth--;
+            }
+            else if (!node->Count)
+            {
+                ast = node->Right;
+                depth--; // The last operand decides the result alone
+            }
+            else if (++frame->Index < node->Count)
+            {
+                ast = &node->Left[frame->Index];
+            }
+            else
+            {
+                depth--;
+            }
+        }
+
+        if (!ast) { return value; }
+    }
 }
 
-/* GetInteger
- * From the current location in the parse text, return an integer.
+/* emit
+ * Append one byte to a program being compiled
  */
-static uint8_t GetInteger(Parser * parser)
+static bool emit(LEPProgram * program, uint8_t byte)
 {
-    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, 0);
-
-    skipWhitespaces(parser);
+    if (program->Length >= LEP_MAX_PROGRAM_LENGTH) { return false; }
 
-    int index = parser->m_Index;
-    while(isdigit(parser->m_Text[parser->m_Index])) parser->m_Index++;
+    program->Code[program->Length++] = byte;
+    return true;
+}
 
-    if(parser->m_Index - index == 0)
+/* compileOperand
+ * Emit one operand of an AND or OR. Every operand but the first is preceded by
+ * a jump to the end of the operator, taken when the accumulator already decides
+ * the result. Until the end is known, each offset byte holds the position of the
+ * previous one, with *chain the most recent (NO_JUMP when there are none).
+ */
+static bool compileOperand(ASTNode * ast, ASTNodeType type, LEPProgram * program, bool first, uint8_t * chain)
+{
+    if (!first)
     {
-        parser->m_success = false;
-        snprintf(parser->m_errorMessage, sizeof(parser->m_errorMessage), "Number expected but not found at position %d!", (int)parser->m_Index);
-        return 0;
+        if (!emit(program, type == OperatorAnd ? LEP_OP_JUMP_IF_FALSE : LEP_OP_JUMP_IF_TRUE)) { return false; }
+        if (!emit(program, *chain)) { return false; }
+        *chain = program->Length - 1;
     }
 
-    char buffer[32] = {0};
-    memcpy(buffer, &parser->m_Text[index], parser->m_Index - index);
+    return compileNode(ast, program);
+}
 
-    unsigned long result = atol(buffer);
+/* compileNode
+ * Emit the code for the subtree at ast
+ */
+static bool compileNode(ASTNode * ast, LEPProgram * program)
+{
+    uint8_t chain = NO_JUMP;
+    uint8_t previous;
+    uint8_t i;
+
+    if (ast == NULL) { return false; }
 
-    if (result > 255)
+    switch(ast->Type)
     {
-        parser->m_success = false;
-        snprintf(parser->m_errorMessage, sizeof(parser->m_errorMessage), "Function ID %lu exceeds 255!", result);
-        return 0;
+        case FunctionID:
+            if (!emit(program, LEP_OP_CALL)) { return false; }
+            return emit(program, ast->Value);
+
+        case BoolValue:
+            return emit(program, ast->Value ? LEP_OP_TRUE : LEP_OP_FALSE);
+
+        case UnaryNot:
+            if (!compileNode(ast->Left, program)) { return false; }
+            return emit(program, LEP_OP_NOT);
+
+        case OperatorAnd:
+        case OperatorOr:
+            if (ast->Count)
+            {
+                for (i = 0; i < ast->Count; ++i)
+                {
+                    if (!compileOperand(&ast->Left[i], ast->Type, program, i == 0, &chain)) { return false; }
+                }
+            }
+            else
+            {
+                if (!compileOperand(ast->Left, ast->Type, program, true, &chain)) { return false; }
+                if (!compileOperand(ast->Right, ast->Type, program, false, &chain)) { return false; }
+            }
+
+            // All jumps go to the end of this operator
+            while (chain != NO_JUMP)
+            {
+                previous = program->Code[chain];
+                program->Code[chain] = program->Length - (chain + 1);
+                chain = previous;
+            }
+            return true;
+
+        default:
+            return false;
     }
+}
 
-    if (result >= s_num_of_functions)
+/* LEP_Compile
+ * Flatten the AST into a program for LEP_Run.
+ * Fails if the program would exceed LEP_MAX_PROGRAM_LENGTH.
+ */
+bool LEP_Compile(ASTNode * ast, LEPProgram * program)
+{
+    if (!program) { return false; }
+
+    program->Length = 0;
+
+    if (!compileNode(ast, program))
     {
-        parser->m_success = false;
-        snprintf(parser->m_errorMessage, sizeof(parser->m_errorMessage), "Function ID %lu exceeds maximum allocation of s_num_of_functions!", result);
-        return 0;
+        program->Length = 0;
+        return false;
     }
 
-    return (uint8_t)result;
+    return true;
 }
 
-/* getNextToken
- * Skip to the next token in the input string and tag appropriately for processing
+/* LEP_Run
+ * Evaluate a compiled program, without recursion. As with LEP_Evaluate, functions
+ * whose result cannot change the outcome are not called.
  */
-static void getNextToken(Parser * parser)
+bool LEP_Run(LEPProgram const * program)
 {
-    ON_PARSER_ERROR_EXIT_EARLY(parser);
+    bool accumulator = false;
+    uint8_t pc;
 
-    // ignore white spaces
-    skipWhitespaces(parser);
+    if (!program || !program->Length) { return false; }
 
-    parser->m_crtToken.Value = 0;
-    parser->m_crtToken.Symbol = 0;
-    parser->m_crtToken.Type = Error;
+    for (pc = 0; pc < program->Length; ++pc)
+    {
+        switch(program->Code[pc])
+        {
+            case LEP_OP_FALSE: accumulator = false; break;
+            case LEP_OP_TRUE: accumulator = true; break;
+            case LEP_OP_CALL: accumulator = callFunction(program->Code[++pc]); break;
+            case LEP_OP_NOT: accumulator = !accumulator; break;
+            case LEP_OP_JUMP_IF_FALSE: ++pc; if (!accumulator) { pc += program->Code[pc]; } break;
+            case LEP_OP_JUMP_IF_TRUE: ++pc; if (accumulator) { pc += program->Code[pc]; } break;
+            default: return false;
+        }
+    }
+
+    return accumulator;
+}
+
+/* markSupport
+ * Flag every function ID used in the tree
+ */
+static void markSupport(ASTNode const * ast, bool * used)
+{
+    uint8_t i;
 
-    DEBUG( printf("Next token: '%c'\n", parser->m_Text[parser->m_Index]) );
+    if (!ast) { return; }
 
-    // test for the end of text
-    if(parser->m_Text[parser->m_Index] == 0)
+    switch(ast->Type)
     {
-        parser->m_crtToken.Type = EndOfText; // No more text to parse
-        return;
+        case FunctionID:
+            used[ast->Value] = true;
+            break;
+        case BoolValue:
+            break;
+        default:
+            if (ast->Count)
+            {
+                for (i = 0; i < ast->Count; ++i) { markSupport(&ast->Left[i], used); }
+            }
+            else
+            {
+                markSupport(ast->Left, used);
+                markSupport(ast->Right, used);
+            }
+            break;
     }
+}
 
-    // if the current character is a digit then parse to the end of the number
-    if(isdigit(parser->m_Text[parser->m_Index]))
+/* evaluateIndex
+ * Evaluate the tree without calling any functions: each function's result is
+ * bit position[fid] of index
+ */
+static bool evaluateIndex(ASTNode const * ast, uint8_t const * position, uint16_t index)
+{
+    bool decisive;
+    uint8_t i;
+
+    switch(ast->Type)
     {
-        parser->m_crtToken.Type = Number;
-        parser->m_crtToken.Value = GetInteger(parser);
-        return;
+        case FunctionID:
+            return (index >> position[ast->Value]) & 1;
+        case BoolValue:
+            return ast->Value;
+        case UnaryNot:
+            return !evaluateIndex(ast->Left, position, index);
+        case OperatorAnd:
+        case OperatorOr:
+            decisive = (ast->Type == OperatorOr);
+            if (ast->Count)
+            {
+                for (i = 0; i < ast->Count; ++i)
+                {
+                    if (evaluateIndex(&ast->Left[i], position, index) == decisive) { return decisive; }
+                }
+                return !decisive;
+            }
+            if (evaluateIndex(ast->Left, position, index) == decisive) { return decisive; }
+            return evaluateIndex(ast->Right, position, index);
+        default:
+            return false;
     }
+}
 
-    // T and F represent constant True and False values
-    if(parser->m_Text[parser->m_Index] == 'T' || parser->m_Text[parser->m_Index] == 'F')
+/* LEP_CompileTable
+ * Tabulate the expression over every combination of the functions it uses.
+ * Returns false (leaving the table empty) if it uses too many functions, or a
+ * function ID that does not fit the packed inputs.
+ */
+bool LEP_CompileTable(ASTNode * ast, LEPTable * table)
+{
+    bool used[s_num_of_functions];
+    uint8_t position[s_num_of_functions];
+    uint16_t index;
+    uint16_t entries;
+    uint8_t fid;
+
+    if (!ast || !table) { return false; }
+
+    memset(table, 0, sizeof(LEPTable));
+    memset(used, 0, sizeof(used));
+    markSupport(ast, used);
+
+    table->Direct = true;
+    for (fid = 0; fid < s_num_of_functions; ++fid)
     {
-        parser->m_crtToken.Type = BoolChar;
-        parser->m_crtToken.Value = (uint8_t)(parser->m_Text[parser->m_Index] == 'T');
-        parser->m_Index++;
-        return;
+        if (!used[fid]) { continue; }
+
+        if ((table->InputCount == LEP_TABLE_MAX_INPUTS) || (fid >= 32))
+        {
+            table->InputCount = 0;
+            return false;
+        }
+
+        table->Direct &= (fid == table->InputCount);
+        position[fid] = table->InputCount;
+        table->Inputs[table->InputCount++] = fid;
     }
 
-    // check if the current character is an operator or parentheses
-    switch(parser->m_Text[parser->m_Index])
+    entries = 1U << table->InputCount;
+    for (index = 0; index < entries; ++index)
     {
-        case '&': parser->m_crtToken.Type = And; break;
-        case '|': parser->m_crtToken.Type = Or; break;
-        case '!': parser->m_crtToken.Type = Not; break;
-        case '(': parser->m_crtToken.Type = OpenParenthesis; break;
-        case ')': parser->m_crtToken.Type = ClosedParenthesis; break;
-        default: break;
+        if (evaluateIndex(ast, position, index))
+        {
+            table->Bits[index / 8] |= (1 << (index % 8));
+        }
     }
 
-    if(parser->m_crtToken.Type != Error)
+    return true;
+}
+
+/* LEP_RunTable
+ * Look up the result for a packed snapshot of function results
+ * (e.g. from LEP_ReadInputs)
+ */
+bool LEP_RunTable(LEPTable const * table, LEPINPUTS inputs)
+{
+    uint16_t index = 0;
+    uint8_t i;
+
+    if (!table) { return false; }
+
+    if (table->Direct)
     {
-        parser->m_crtToken.Symbol = parser->m_Text[parser->m_Index];
-        parser->m_Index++;
+        index = inputs & ((1UL << table->InputCount) - 1);
     }
     else
     {
-        parser->m_success = false;
-        if (parser->m_Text[parser->m_Index])
+        for (i = 0; i < table->InputCount; ++i)
         {
-            snprintf(parser->m_errorMessage, sizeof(parser->m_errorMessage), "%s: At position %d unexpected token '%c'",
-                __func__, (int)parser->m_Index, parser->m_Text[parser->m_Index]);
+            index |= ((inputs >> table->Inputs[i]) & 1) << i;
         }
     }
+
+    return (table->Bits[index / 8] >> (index % 8)) & 1;
 }
 
-/* LEP_Init
- * Initialises this module
+/* LEP_ReadInputs
+ * Call every registered function (up to ID 31) and pack the results
  */
-void LEP_Init(void)
+LEPINPUTS LEP_ReadInputs(void)
 {
+    LEPINPUTS inputs = 0;
+    uint8_t fid;
+
+    for (fid = 0; (fid < s_num_of_functions) && (fid < 32); ++fid)
+    {
+        inputs |= (LEPINPUTS)callFunction(fid) << fid;
+    }
+
+    return inputs;
+}
+
+/* LEP_EvaluateBatch
+ * Evaluate the expression for 64 time steps at once. inputs holds one word per
+ * function ID, bit n being that function's result at step n; bit n of the
+ * result is the expression's value at step n. No functions are called.
+ */
+uint64_t LEP_EvaluateBatch(ASTNode const * ast, uint64_t const * inputs)
+{
+    uint64_t result;
     uint8_t i;
-    for (i = 0; i < s_num_of_functions; ++i)
+
+    if (!ast) { return 0; }
+
+    switch(ast->Type)
     {
-        // Ensure all functions start off pointing at the root
-        s_functions[i] = defaultFn;
+        case FunctionID:
+            return inputs[ast->Value];
+        case BoolValue:
+            return ast->Value ? ~(uint64_t)0 : 0;
+        case UnaryNot:
+            return ~LEP_EvaluateBatch(ast->Left, inputs);
+        case OperatorAnd:
+            if (!ast->Count)
+            {
+                result = LEP_EvaluateBatch(ast->Left, inputs);
+                return result ? (result & LEP_EvaluateBatch(ast->Right, inputs)) : 0;
+            }
+            result = ~(uint64_t)0;
+            for (i = 0; (i < ast->Count) && result; ++i) { result &= LEP_EvaluateBatch(&ast->Left[i], inputs); }
+            return result;
+        case OperatorOr:
+            if (!ast->Count)
+            {
+                result = LEP_EvaluateBatch(ast->Left, inputs);
+                return ~result ? (result | LEP_EvaluateBatch(ast->Right, inputs)) : result;
+            }
+            result = 0;
+            for (i = 0; (i < ast->Count) && ~result; ++i) { result |= LEP_EvaluateBatch(&ast->Left[i], inputs); }
+            return result;
+        default:
+            return 0;
     }
 }
 
-/* LEP_Evaluate
- * Evaluate the AST starting at the given root node.
- * Called recursively for each node
+#if defined(LEP_AVX2)
+
+static __m256i evaluateBatch256(ASTNode const * ast, LEPBatch256 const * inputs)
+{
+    __m256i result;
+    uint8_t i;
+
+    switch(ast->Type)
+    {
+        case FunctionID:
+            return _mm256_loadu_si256((__m256i const *)inputs[ast->Value].Words);
+        case BoolValue:
+            return _mm256_set1_epi64x(ast->Value ? -1 : 0);
+        case UnaryNot:
+            return _mm256_xor_si256(evaluateBatch256(ast->Left, inputs), _mm256_set1_epi64x(-1));
+        case OperatorAnd:
+            if (!ast->Count)
+            {
+                return _mm256_and_si256(evaluateBatch256(ast->Left, inputs), evaluateBatch256(ast->Right, inputs));
+            }
+            result = _mm256_set1_epi64x(-1);
+            for (i = 0; i < ast->Count; ++i) { result = _mm256_and_si256(result, evaluateBatch256(&ast->Left[i], inputs)); }
+            return result;
+        case OperatorOr:
+            if (!ast->Count)
+            {
+                return _mm256_or_si256(evaluateBatch256(ast->Left, inputs), evaluateBatch256(ast->Right, inputs));
+            }
+            result = _mm256_setzero_si256();
+            for (i = 0; i < ast->Count; ++i) { result = _mm256_or_si256(result, evaluateBatch256(&ast->Left[i], inputs)); }
+            return result;
+        default:
+            return _mm256_setzero_si256();
+    }
+}
+
+#endif
+
+/* LEP_EvaluateBatch256
+ * As LEP_EvaluateBatch, for 256 time steps (one AVX2 register, or four 64-bit
+ * words where AVX2 is not available)
  */
-bool LEP_Evaluate(ASTNode* ast)
+LEPBatch256 LEP_EvaluateBatch256(ASTNode const * ast, LEPBatch256 const * inputs)
 {
+    LEPBatch256 result;
 
-    if(ast == NULL) { return false; }
+    if (!ast)
+    {
+        memset(&result, 0, sizeof(result));
+        return result;
+    }
+
+#if defined(LEP_AVX2)
+    _mm256_storeu_si256((__m256i *)result.Words, evaluateBatch256(ast, inputs));
+#else
+    uint64_t words[s_num_of_functions];
+    uint8_t w;
+    uint8_t fid;
+
+    for (w = 0; w < 4; ++w)
+    {
+        for (fid = 0; fid < s_num_of_functions; ++fid) { words[fid] = inputs[fid].Words[w]; }
+        result.Words[w] = LEP_EvaluateBatch(ast, words);
+    }
+#endif
+
+    return result;
+}
+
+/* LEP_Prepare
+ * Choose the fastest form for the expression: a truth table if it uses few enough
+ * functions, otherwise a compiled program, otherwise the tree itself.
+ * The tree must outlive the expression.
+ */
+LEPMode LEP_Prepare(ASTNode * ast, LEPExpression * expression)
+{
+    expression->Tree = ast;
 
-    if(ast->Type == FunctionID)
+    if (LEP_CompileTable(ast, &expression->Table))
     {
-        // Invoke and return the boolean function for the node
-        return s_functions[ast->Value]();
+        expression->Mode = LEP_MODE_TABLE;
     }
-    else if(ast->Type == UnaryNot)
+    else if (LEP_Compile(ast, &expression->Program))
     {
-        // Return the inverse of the subtree below this node
-        return !LEP_Evaluate(ast->Left);
+        expression->Mode = LEP_MODE_PROGRAM;
     }
     else
     {
-        // Return either the AND or OR of the two subtrees below this node
-        bool v1 = LEP_Evaluate(ast->Left);
-        bool v2 = LEP_Evaluate(ast->Right);
-        switch(ast->Type)
+        expression->Mode = LEP_MODE_TREE;
+    }
+
+    return expression->Mode;
+}
+
+/* LEP_EvaluateExpression
+ * Evaluate a prepared expression. In table mode every function the expression
+ * uses is called once (no short-circuiting) and the result looked up.
+ */
+bool LEP_EvaluateExpression(LEPExpression const * expression)
+{
+    LEPTable const * table = &expression->Table;
+    LEPINPUTS inputs = 0;
+    uint8_t i;
+
+    switch(expression->Mode)
+    {
+        case LEP_MODE_TABLE:
+            for (i = 0; i < table->InputCount; ++i)
+            {
+                inputs |= (LEPINPUTS)callFunction(table->Inputs[i]) << table->Inputs[i];
+            }
+            return LEP_RunTable(table, inputs);
+        case LEP_MODE_PROGRAM:
+            return LEP_Run(&expression->Program);
+        default:
+            return LEP_Evaluate(expression->Tree);
+    }
+}
+
+/* makeConstant
+ * Turn a node into a T or F leaf
+ */
+static ASTNode* makeConstant(ASTNode * node, bool value)
+{
+    node->Type = BoolValue;
+    node->Value = value;
+    node->Count = 0;
+    node->Left = NULL;
+    node->Right = NULL;
+    return node;
+}
+
+/* simplify
+ * Bottom-up rewrite of a binary tree from LEP_Parse: drops identity operands
+ * (T under AND, F under OR), folds constants and removes double negation.
+ * Returns the replacement for node, which may be one of its descendants.
+ */
+static ASTNode* simplify(ASTNode * node)
+{
+    ASTNode* left;
+    ASTNode* right;
+
+    if (!node) { return node; }
+
+    switch(node->Type)
+    {
+        case UnaryNot:
+            left = simplify(node->Left);
+            if (left->Type == BoolValue) { return makeConstant(node, !left->Value); }
+            if (left->Type == UnaryNot) { return left->Left; }
+            node->Left = left;
+            return node;
+
+        case OperatorAnd:
+        case OperatorOr:
         {
-            case OperatorAnd:  return v1 && v2;
-            case OperatorOr: return v1 || v2;
-            default:
-                break;
+            bool identity = (node->Type == OperatorAnd);
+            left = simplify(node->Left);
+            right = simplify(node->Right);
+
+            if ((left->Type == BoolValue) && (left->Value == identity)) { return right; }
+            if ((right->Type == BoolValue) && (right->Value == identity)) { return left; }
+            if ((left->Type == BoolValue) || (right->Type == BoolValue)) { return makeConstant(node, !identity); }
+
+            node->Left = left;
+            node->Right = right;
+            return node;
         }
+
+        default:
+            return node;
     }
+}
 
-    return false;
+/* operandCount
+ * Number of operands of a chain of binary nodes of the same type, once flattened
+ */
+static uint8_t operandCount(ASTNode const * node, ASTNodeType type)
+{
+    if (node->Type != type) { return 1; }
+
+    return operandCount(node->Left, type) + operandCount(node->Right, type);
+}
+
+/* chainSize
+ * Arena nodes used by the operands of a chain of the given type (the chain nodes themselves disappear)
+ */
+static uint8_t chainSize(ASTNode const * node, ASTNodeType type)
+{
+    if (node->Type != type) { return layoutSize(node); }
+
+    return chainSize(node->Left, type) + chainSize(node->Right, type);
+}
+
+/* layoutSize
+ * Number of arena nodes layout() will use for the simplified tree at node
+ */
+static uint8_t layoutSize(ASTNode const * node)
+{
+    switch(node->Type)
+    {
+        case UnaryNot:
+            return 1 + layoutSize(node->Left);
+        case OperatorAnd:
+        case OperatorOr:
+            return 1 + chainSize(node->Left, node->Type) + chainSize(node->Right, node->Type);
+        default:
+            return 1;
+    }
+}
+
+/* fillOperands
+ * Write the flattened operands of a chain into consecutive slots, returning the next free slot
+ */
+static ASTNode* fillOperands(ASTNode const * node, ASTNodeType type, ASTNode * slot)
+{
+    if (node->Type != type)
+    {
+        *slot = *node;
+        return slot + 1;
+    }
+
+    slot = fillOperands(node->Left, type, slot);
+    return fillOperands(node->Right, type, slot);
+}
+
+/* layout
+ * Copy the simplified tree at node into slot, allocating the children of each
+ * AND/OR/NOT as one contiguous block of the arena.
+ */
+static void layout(ASTNode const * node, ASTNode * slot, ASTArena * arena)
+{
+    ASTNode* children;
+    uint8_t count;
+    uint8_t i;
+
+    slot->Type = node->Type;
+    slot->Value = node->Value;
+    slot->Count = 0;
+    slot->Left = NULL;
+    slot->Right = NULL;
+
+    switch(node->Type)
+    {
+        case UnaryNot:
+            count = 1;
+            children = &arena->Nodes[arena->Count];
+            arena->Count += count;
+            *children = *node->Left;
+            break;
+
+        case OperatorAnd:
+        case OperatorOr:
+            count = operandCount(node, node->Type);
+            children = &arena->Nodes[arena->Count];
+            arena->Count += count;
+            fillOperands(node, node->Type, children);
+            break;
+
+        default:
+            return;
+    }
+
+    slot->Count = count;
+    slot->Left = children;
+
+    // The children are shallow copies until laid out in turn
+    for (i = 0; i < count; ++i)
+    {
+        ASTNode source = children[i];
+        layout(&source, &children[i], arena);
+    }
+}
+
+/* LEP_Optimise
+ * Rewrite a tree from LEP_Parse into the arena in optimised form: identity operands
+ * and double negation removed, constants folded and chains of the same operator
+ * flattened into n-ary nodes whose children are contiguous. The source tree is
+ * modified and must not be in the destination arena. Like LEP_Parse, fails with arena->Count set to the size needed if the
+ * arena is too small.
+ */
+ASTNode * LEP_Optimise(Parser * parser, ASTNode * root, ASTArena * arena)
+{
+    if (!parser || !root || !arena) { return NULL; }
+
+    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
+
+    if (root->Count) { return NULL; } // Already optimised
+
+    root = simplify(root);
+
+    uint8_t needed = layoutSize(root);
+
+    if (needed > arena->Capacity)
+    {
+        arena->Count = needed;
+        LEP_SetError(parser, LEP_ERROR_ARENA_TOO_SMALL, parser->m_Index, needed);
+        return NULL;
+    }
+
+    arena->Count = 1;
+    layout(root, &arena->Nodes[0], arena);
+
+    return &arena->Nodes[0];
 }
 
 /* LEP_Parse
  * Parse and produce an AST for the given text, but do not evaluate.
+ * With an arena, the tree is moved into it and stays valid until the arena is reused.
+ * Without one (NULL), the tree is left in the shared pool and the next parse overwrites it.
  */
-ASTNode * LEP_Parse(Parser * parser, const char* text)
+ASTNode * LEP_Parse(Parser * parser, const char* text, ASTArena * arena)
 {
     if (!parser) { return NULL; }
 
     AST_Init();
 
-    parser->m_Text = text;
-    parser->m_Index = 0;
-    parser->m_success = true;
-    parser->m_errorMessage[0] = '\0';
+    startParse(parser, text, LEP_NUL_TERMINATED);
 
-    getNextToken(parser);
+    ASTNode * root = AST_PoolNode(parseExpression(parser, NULL));
+
+    if (arena && root)
+    {
+        root = AST_Compact(parser, root, arena);
+    }
+
+    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
+
+    return root;
+}
+
+/* LEP_ParseCompact
+ * Parse straight into caller-owned compact nodes (see CompactNode), replacing the
+ * arena's contents. Returns the root's index, or LEP_NO_NODE on error.
+ */
+uint16_t LEP_ParseCompact(Parser * parser, const char* text, CompactArena * arena)
+{
+    if (!parser || !arena) { return LEP_NO_NODE; }
+
+    startParse(parser, text, LEP_NUL_TERMINATED);
+
+    return parseExpression(parser, arena);
+}
+
+/* LEP_Check
+ * Parse length characters of text (which need not be NUL terminated) only to
+ * check them, reporting any error as LEP_Parse would. Uses, and so overwrites,
+ * the shared pool.
+ */
+bool LEP_Check(Parser * parser, const char* text, size_t length)
+{
+    if (!parser || !text) { return false; }
+
+    AST_Init();
+
+    startParse(parser, text, length);
+
+    return parseExpression(parser, NULL) != LEP_NO_NODE;
+}
+
+/* LEP_EvaluateCompact
+ * As LEP_Evaluate, for a tree from LEP_ParseCompact
+ */
+bool LEP_EvaluateCompact(CompactArena const * arena, uint16_t root)
+{
+    uint16_t stack[LEP_EVALUATION_DEPTH]; // Pending NOT, AND or OR nodes
+    uint8_t depth = 0;
+    uint16_t index = root;
+    bool value;
+
+    s_tooDeep = false;
+
+    if (!arena || (root >= arena->Count)) { return false; }
+
+    while (true)
+    {
+        CompactNode const * node = &arena->Nodes[index];
+
+        // Descend the left operands to a leaf
+        while ((node->Type == UnaryNot) || (node->Type == OperatorAnd) || (node->Type == OperatorOr))
+        {
+            if (depth == LEP_EVALUATION_DEPTH) { s_tooDeep = true; return false; }
+
+            stack[depth++] = index;
+            index = node->Left;
+            node = &arena->Nodes[index];
+        }
+
+        value = (node->Type == FunctionID) ? callFunction(node->Value) : ((node->Type == BoolValue) && node->Value);
+
+        // Ascend until an AND or OR needs its second operand
+        index = LEP_NO_NODE;
+        while (depth && (index == LEP_NO_NODE))
+        {
+            node = &arena->Nodes[stack[--depth]];
+
+            if (node->Type == UnaryNot)
+            {
+                value = !value;
+            }
+            else if (value != (node->Type == OperatorOr))
+            {
+                index = node->Right; // Not yet decided: the result is the second operand's
+            }
+        }
+
+        if (index == LEP_NO_NODE) { return value; }
+    }
+}
+
+/* LEP_EvaluationTooDeep
+ * True if the last LEP_Evaluate or LEP_EvaluateCompact gave up on a tree nested
+ * deeper than LEP_EVALUATION_DEPTH, so its false result means nothing
+ */
+bool LEP_EvaluationTooDeep(void)
+{
+    return s_tooDeep;
+}
+
+/* LEP_ParseShared
+ * Parse, drop identity operands and move the tree into the hash-consed store shared
+ * by all expressions parsed this way (see AST_Share). Evaluate with LEP_EvaluateShared.
+ */
+ASTNode * LEP_ParseShared(Parser * parser, const char* text)
+{
+    ASTNode * root = LEP_Parse(parser, text, NULL);
+
+    ON_PARSER_ERROR_EXIT_EARLY_WITH_RTN(parser, NULL);
+
+    return AST_Share(parser, simplify(root));
+}
+
+/* LEP_EvaluateShared
+ * As LEP_Evaluate, but each shared node is evaluated at most once per tick and its
+ * value reused by every expression containing it. Call AST_NextTick at the start of
+ * each tick so that functions are called again.
+ */
+bool LEP_EvaluateShared(ASTNode * ast)
+{
+    bool decisive;
+    bool value;
+
+    if (!ast) { return false; }
+    if (AST_GetMemo(ast, &value)) { return value; }
+
+    switch(ast->Type)
+    {
+        case FunctionID:
+            value = callFunction(ast->Value);
+            break;
+        case BoolValue:
+            value = ast->Value;
+            break;
+        case UnaryNot:
+            value = !LEP_EvaluateShared(ast->Left);
+            break;
+        case OperatorAnd:
+        case OperatorOr:
+            decisive = (ast->Type == OperatorOr);
+            value = (LEP_EvaluateShared(ast->Left) == decisive) ? decisive : LEP_EvaluateShared(ast->Right);
+            break;
+        default:
+            value = false;
+            break;
+    }
+
+    AST_SetMemo(ast, value);
+    return value;
+}
+
+/* leafEstimate
+ * Cost and probability of a function from its recorded history
+ */
+static Estimate leafEstimate(uint8_t fid)
+{
+    Estimate estimate = {1, P_ONE / 2}; // Unknown: cheap and unbiased
+    FunctionStats const * stats = &s_stats[fid];
+
+    if (stats->Calls)
+    {
+        estimate.Cost = stats->Cost / stats->Calls;
+        estimate.PTrue = ((uint32_t)stats->Trues * P_ONE) / stats->Calls;
+    }
+
+    return estimate;
+}
+
+/* decisiveProbability
+ * Probability that an operand decides its AND (by being false) or OR (by being true)
+ */
+static uint16_t decisiveProbability(Estimate const * estimate, ASTNodeType type)
+{
+    return (type == OperatorAnd) ? (P_ONE - estimate->PTrue) : estimate->PTrue;
+}
+
+/* goesFirst
+ * True if operand a should be evaluated before b: the one with the lower cost
+ * per chance of deciding the result (optimal for independent operands).
+ */
+static bool goesFirst(Estimate const * a, Estimate const * b, ASTNodeType type)
+{
+    uint64_t a_rank = (uint64_t)a->Cost * decisiveProbability(b, type);
+    uint64_t b_rank = (uint64_t)b->Cost * decisiveProbability(a, type);
+    return a_rank < b_rank;
+}
+
+/* combine
+ * Add an operand's estimate to the running estimate of an AND or OR (operands
+ * assumed independent). reach is the probability of evaluating the operand at all.
+ */
+static void combine(Estimate * total, uint16_t * reach, Estimate const * operand, ASTNodeType type)
+{
+    total->Cost += ((uint64_t)operand->Cost * *reach) / P_ONE;
+    *reach = ((uint32_t)*reach * (P_ONE - decisiveProbability(operand, type))) / P_ONE;
+    total->PTrue = (type == OperatorAnd) ? *reach : (P_ONE - *reach);
+}
+
+/* ChainCursor
+ * Walks the operands of a binary AND or OR chain: the Left of each link, then the
+ * Right of the last. A link is a binary node of the chain's type, so a(b(c d))
+ * and the chains LEP_Parse builds leaning right are walked without recursion.
+ */
+typedef struct
+{
+    ASTNode * Link;
+    ASTNodeType Type;
+    bool Last;
+} ChainCursor;
+
+static bool isChainLink(ASTNode const * node, ASTNodeType type)
+{
+    return (node->Type == type) && !node->Count;
+}
+
+static void chainStart(ChainCursor * cursor, ASTNode * chain)
+{
+    cursor->Link = chain;
+    cursor->Type = chain->Type;
+    cursor->Last = false;
+}
+
+static ASTNode ** chainSlot(ChainCursor const * cursor)
+{
+    return cursor->Last ? &cursor->Link->Right : &cursor->Link->Left;
+}
+
+static bool chainNext(ChainCursor * cursor)
+{
+    if (cursor->Last) { return false; }
+
+    if (isChainLink(cursor->Link->Right, cursor->Type)) { cursor->Link = cursor->Link->Right; }
+    else { cursor->Last = true; }
+
+    return true;
+}
+
+/* estimate
+ * Cost and probability of ast with its operands evaluated in their current order
+ */
+static Estimate estimate(ASTNode const * ast)
+{
+    Estimate total = {0, 0};
+    Estimate operand;
+    uint16_t reach = P_ONE;
+    ChainCursor cursor;
+    uint8_t i;
+
+    switch(ast->Type)
+    {
+        case FunctionID:
+            return leafEstimate(ast->Value);
+
+        case BoolValue:
+            total.PTrue = ast->Value ? P_ONE : 0;
+            return total;
+
+        case UnaryNot:
+            total = estimate(ast->Left);
+            total.PTrue = P_ONE - total.PTrue;
+            return total;
+
+        case OperatorAnd:
+        case OperatorOr:
+            if (ast->Count)
+            {
+                for (i = 0; i < ast->Count; ++i)
+                {
+                    operand = estimate(&ast->Left[i]);
+                    combine(&total, &reach, &operand, ast->Type);
+                }
+            }
+            else
+            {
+                chainStart(&cursor, (ASTNode *)ast);
+                do
+                {
+                    operand = estimate(*chainSlot(&cursor));
+                    combine(&total, &reach, &operand, ast->Type);
+                } while (chainNext(&cursor));
+            }
+            return total;
+
+        default:
+            return total;
+    }
+}
+
+/* reorder
+ * Reorder the operands below ast (see LEP_Reorder). Operand estimates are
+ * recalculated rather than kept in a per-level array, so stack use is fixed, and
+ * a binary chain is sorted in place (its links are left as they are), so only
+ * nesting, not chain length, adds to the recursion.
+ */
+static void reorder(ASTNode * ast)
+{
+    ChainCursor cursor;
+    ChainCursor candidate;
+    ASTNode ** best;
+    ASTNode * swap;
+    Estimate best_estimate;
+    Estimate candidate_estimate;
+    uint8_t i;
+    uint8_t j;
+
+    switch(ast->Type)
+    {
+        case UnaryNot:
+            reorder(ast->Left);
+            break;
+
+        case OperatorAnd:
+        case OperatorOr:
+            if (ast->Count)
+            {
+                for (i = 0; i < ast->Count; ++i) { reorder(&ast->Left[i]); }
+
+                // Insertion sort of the contiguous children
+                for (i = 1; i < ast->Count; ++i)
+                {
+                    ASTNode node = ast->Left[i];
+                    Estimate node_estimate = estimate(&node);
+                    for (j = i; j > 0; --j)
+                    {
+                        Estimate previous = estimate(&ast->Left[j - 1]);
+                        if (!goesFirst(&node_estimate, &previous, ast->Type)) { break; }
+                        ast->Left[j] = ast->Left[j - 1];
+                    }
+                    ast->Left[j] = node;
+                }
+            }
+            else
+            {
+                chainStart(&cursor, ast);
+                do { reorder(*chainSlot(&cursor)); } while (chainNext(&cursor));
+
+                // Selection sort of the chain's operands
+                chainStart(&cursor, ast);
+                do
+                {
+                    best = chainSlot(&cursor);
+                    best_estimate = estimate(*best);
+                    candidate = cursor;
+                    while (chainNext(&candidate))
+                    {
+                        candidate_estimate = estimate(*chainSlot(&candidate));
+                        if (goesFirst(&candidate_estimate, &best_estimate, ast->Type))
+                        {
+                            best = chainSlot(&candidate);
+                            best_estimate = candidate_estimate;
+                        }
+                    }
+                    swap = *chainSlot(&cursor);
+                    *chainSlot(&cursor) = *best;
+                    *best = swap;
+                } while (chainNext(&cursor));
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* LEP_SetAdaptive
+ * In adaptive mode every function call records its result and, if a clock is
+ * given, how many clock ticks it took (otherwise every call costs 1).
+ */
+void LEP_SetAdaptive(bool enable, LEPCLOCK clock)
+{
+    s_adaptive = enable;
+    s_clock = clock;
+}
+
+/* LEP_Reorder
+ * Using the history recorded in adaptive mode, reorder the operands of every AND
+ * and OR in the tree so that cheap operands likely to decide the result are
+ * evaluated first. Compiled programs must be recompiled to pick up the new order.
+ * Trees from LEP_ParseShared are refused (returning false): their nodes are
+ * hashed by content and used by other expressions, so must not be changed.
+ */
+bool LEP_Reorder(ASTNode * ast)
+{
+    if (!ast) { return false; }
+    if (AST_IsShared(ast)) { return false; }
+
+    reorder(ast);
+    return true;
+}
+
+/* LEP_CallFunction
+ * Call a registered function (recording it in adaptive mode) for evaluators
+ * outside this module. Out of range IDs return false.
+ */
+bool LEP_CallFunction(uint8_t fid)
+{
+    if (fid >= s_num_of_functions) { return false; }
 
-    return expression(parser);
+    return callFunction(fid);
 }
 
 /* LEP_RegisterFunction
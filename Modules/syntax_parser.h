@@ -17,6 +17,7 @@
 #endif
 
 typedef bool (*BOOLFUNCTION)(void);
+typedef uint32_t (*LEPCLOCK)(void);
 
 typedef struct astnode ASTNode;
 
@@ -26,7 +27,28 @@ typedef struct astnode ASTNode;
 
 void LEP_Init(void);
 bool LEP_Evaluate(ASTNode *);
-ASTNode * LEP_Parse(Parser * parser, const char* text);
+bool LEP_EvaluationTooDeep(void);
+ASTNode * LEP_Parse(Parser * parser, const char* text, ASTArena * arena);
+void LEP_SetError(Parser * parser, LEPError error, size_t position, uint16_t value);
+const char * LEP_GetErrorMessage(Parser * parser);
+uint16_t LEP_ParseCompact(Parser * parser, const char* text, CompactArena * arena);
+bool LEP_Check(Parser * parser, const char* text, size_t length);
+bool LEP_EvaluateCompact(CompactArena const * arena, uint16_t root);
+ASTNode * LEP_ParseShared(Parser * parser, const char* text);
+bool LEP_EvaluateShared(ASTNode * ast);
+ASTNode * LEP_Optimise(Parser * parser, ASTNode * root, ASTArena * arena);
+bool LEP_Compile(ASTNode * ast, LEPProgram * program);
+bool LEP_Run(LEPProgram const * program);
+bool LEP_CompileTable(ASTNode * ast, LEPTable * table);
+bool LEP_RunTable(LEPTable const * table, LEPINPUTS inputs);
+LEPINPUTS LEP_ReadInputs(void);
+uint64_t LEP_EvaluateBatch(ASTNode const * ast, uint64_t const * inputs);
+LEPBatch256 LEP_EvaluateBatch256(ASTNode const * ast, LEPBatch256 const * inputs);
+LEPMode LEP_Prepare(ASTNode * ast, LEPExpression * expression);
+bool LEP_EvaluateExpression(LEPExpression const * expression);
 void LEP_RegisterFunction(uint8_t fid, BOOLFUNCTION fn);
+bool LEP_CallFunction(uint8_t fid);
+void LEP_SetAdaptive(bool enable, LEPCLOCK clock);
+bool LEP_Reorder(ASTNode * ast);
 
 #endif
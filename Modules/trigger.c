@@ -0,0 +1,183 @@
+/* trigger.c
+ * Keeps the results of trigger expressions up to date, re-evaluating each one
+ * only when a function it depends on has changed
+ */
+
+/*
+ * C Library Includes
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/*
+ * Local Module Includes
+ */
+
+#include "syntax_parser.h"
+#include "trigger.h"
+
+/*
+ * Local Application Includes
+ */
+
+#include "app.config.h"
+
+/*
+ * Defines and Typedefs
+ */
+
+#define WORD(fid) ((fid) / 32)
+#define BIT(fid) (1UL << ((fid) % 32))
+
+/*
+ * Private Functions
+ */
+
+/* addDependencies
+ * Set the bit for every function ID referenced by the tree
+ */
+static void addDependencies(ASTNode const * ast, TriggerMask * mask)
+{
+    uint8_t i;
+
+    if (!ast) { return; }
+
+    switch(ast->Type)
+    {
+        case FunctionID:
+            mask->Words[WORD(ast->Value)] |= BIT(ast->Value);
+            break;
+        case BoolValue:
+            break;
+        default:
+            if (ast->Count)
+            {
+                for (i = 0; i < ast->Count; ++i) { addDependencies(&ast->Left[i], mask); }
+            }
+            else
+            {
+                addDependencies(ast->Left, mask);
+                addDependencies(ast->Right, mask);
+            }
+            break;
+    }
+}
+
+/* intersects
+ * True if any function ID is in both masks
+ */
+static bool intersects(TriggerMask const * a, TriggerMask const * b)
+{
+    uint8_t i;
+    uint32_t common = 0;
+
+    for (i = 0; i < TRIGGER_MASK_WORDS; ++i) { common |= a->Words[i] & b->Words[i]; }
+
+    return common != 0;
+}
+
+/*
+ * Public Functions
+ */
+
+void Trigger_Init(TriggerEngine * engine)
+{
+    memset(engine, 0, sizeof(TriggerEngine));
+}
+
+/* Trigger_Set
+ * Compile an expression into the trigger at index, recording its dependencies.
+ * An expression too long to compile is kept as a tree, which must then outlive
+ * the trigger. It is evaluated on the next Trigger_Update whatever has changed.
+ */
+bool Trigger_Set(TriggerEngine * engine, uint16_t index, ASTNode * ast)
+{
+    if (index >= TRIGGER_MAX_COUNT) { return false; }
+
+    Trigger * trigger = &engine->Triggers[index];
+
+    Trigger_Clear(engine, index);
+
+    if (!ast) { return false; }
+
+    if (!LEP_Compile(ast, &trigger->Program)) { trigger->Tree = ast; }
+
+    addDependencies(ast, &trigger->Dependencies);
+    trigger->Active = true;
+    trigger->Stale = true;
+
+    return true;
+}
+
+void Trigger_Clear(TriggerEngine * engine, uint16_t index)
+{
+    if (index >= TRIGGER_MAX_COUNT) { return; }
+
+    memset(&engine->Triggers[index], 0, sizeof(Trigger));
+}
+
+/* Trigger_MarkChanged
+ * Flag that a function's result may have changed since the last update
+ */
+void Trigger_MarkChanged(TriggerEngine * engine, uint8_t fid)
+{
+    if (fid >= (NUMBER_OF_IO + NUMBER_OF_ALARMS)) { return; }
+
+    engine->Changed.Words[WORD(fid)] |= BIT(fid);
+}
+
+void Trigger_MarkAllChanged(TriggerEngine * engine)
+{
+    memset(&engine->Changed, 0xFF, sizeof(TriggerMask));
+}
+
+/* Trigger_SetInput
+ * Mark a function changed only if value differs from the last value given.
+ * The value is only compared: Trigger_Update still calls the function itself.
+ */
+void Trigger_SetInput(TriggerEngine * engine, uint8_t fid, bool value)
+{
+    if (fid >= (NUMBER_OF_IO + NUMBER_OF_ALARMS)) { return; }
+
+    uint32_t * word = &engine->Inputs.Words[WORD(fid)];
+
+    if (((*word & BIT(fid)) != 0) == value) { return; }
+
+    *word ^= BIT(fid);
+    Trigger_MarkChanged(engine, fid);
+}
+
+/* Trigger_Update
+ * Re-evaluate the triggers affected by changes since the last update and clear
+ * the changed mask. Returns the number of expressions evaluated.
+ */
+uint16_t Trigger_Update(TriggerEngine * engine)
+{
+    uint16_t evaluated = 0;
+    uint16_t i;
+
+    for (i = 0; i < TRIGGER_MAX_COUNT; ++i)
+    {
+        Trigger * trigger = &engine->Triggers[i];
+
+        if (!trigger->Active) { continue; }
+        if (!trigger->Stale && !intersects(&trigger->Dependencies, &engine->Changed)) { continue; }
+
+        trigger->Result = trigger->Tree ? LEP_Evaluate(trigger->Tree) : LEP_Run(&trigger->Program);
+        trigger->Stale = false;
+        evaluated++;
+    }
+
+    memset(&engine->Changed, 0, sizeof(TriggerMask));
+
+    return evaluated;
+}
+
+bool Trigger_Result(TriggerEngine const * engine, uint16_t index)
+{
+    if (index >= TRIGGER_MAX_COUNT) { return false; }
+
+    return engine->Triggers[index].Result;
+}
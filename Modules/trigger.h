@@ -1,4 +1,70 @@
 #ifndef _TRIGGER_H_
 #define _TRIGGER_H_
 
+#include "parser_types.h"
+#include "app.config.h"
+
+/*
+ * Defines and Typedefs
+ */
+
+#ifndef TRIGGER_MAX_COUNT
+#define TRIGGER_MAX_COUNT (NUMBER_OF_IO)
+#endif
+
+#define TRIGGER_MASK_WORDS ((NUMBER_OF_IO + NUMBER_OF_ALARMS + 31) / 32)
+
+/*
+ * One bit per function ID
+ */
+struct triggermask
+{
+    uint32_t Words[TRIGGER_MASK_WORDS];
+};
+typedef struct triggermask TriggerMask;
+
+/*
+ * A compiled expression, the function IDs it depends on and its last result.
+ * Tree is only set for an expression too long to compile, which is evaluated
+ * from the tree instead.
+ */
+struct trigger
+{
+    LEPProgram Program;
+    ASTNode * Tree;
+    TriggerMask Dependencies;
+    bool Result;
+    bool Active;
+    bool Stale; // Not evaluated since it was set
+};
+typedef struct trigger Trigger;
+
+/*
+ * Triggers are only re-evaluated by Trigger_Update when a function they depend
+ * on has been marked as changed since the last update. Otherwise the cached
+ * result is kept.
+ */
+struct triggerengine
+{
+    Trigger Triggers[TRIGGER_MAX_COUNT];
+    TriggerMask Changed;
+    TriggerMask Inputs; // Last values given to Trigger_SetInput, only to detect changes
+};
+typedef struct triggerengine TriggerEngine;
+
+/*
+ * Public Function Declarations
+ */
+
+void Trigger_Init(TriggerEngine * engine);
+bool Trigger_Set(TriggerEngine * engine, uint16_t index, ASTNode * ast);
+void Trigger_Clear(TriggerEngine * engine, uint16_t index);
+
+void Trigger_MarkChanged(TriggerEngine * engine, uint8_t fid);
+void Trigger_MarkAllChanged(TriggerEngine * engine);
+void Trigger_SetInput(TriggerEngine * engine, uint8_t fid, bool value);
+
+uint16_t Trigger_Update(TriggerEngine * engine);
+bool Trigger_Result(TriggerEngine const * engine, uint16_t index);
+
 #endif